@@ -0,0 +1,142 @@
+// Generates levels over a matrix of map sizes and room counts and reports
+// percentiles of Generation::Stats for every configuration.
+//
+// usage: bench_generation [--runs N] [--seed S] [--format csv|json]
+//
+// Every value is measured per level, times are in milliseconds.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/generation.hpp"
+#include "../src/percentile.hpp"
+
+struct Config {
+	int width;
+	int height;
+	int rooms;
+};
+
+struct Metric {
+	const char* name;
+	double (*get)(const Generation::Stats&);
+};
+
+static const Metric metrics[] {
+	{ "total_ms",           [](const Generation::Stats& s) { return s.totalSeconds * 1000.0; } },
+	{ "placement_ms",       [](const Generation::Stats& s) { return s.placementSeconds * 1000.0; } },
+	{ "shift_ms",           [](const Generation::Stats& s) { return s.shiftSeconds * 1000.0; } },
+	{ "fill_ms",            [](const Generation::Stats& s) { return s.fillSeconds * 1000.0; } },
+	{ "door_ms",            [](const Generation::Stats& s) { return s.doorSeconds * 1000.0; } },
+	{ "cleanup_ms",         [](const Generation::Stats& s) { return s.cleanupSeconds * 1000.0; } },
+	{ "placement_attempts", [](const Generation::Stats& s) { return (double)s.placementAttempts; } },
+	{ "can_place_rejects",  [](const Generation::Stats& s) { return (double)s.canPlaceRejects; } },
+	{ "flood_fills",        [](const Generation::Stats& s) { return (double)s.floodFills; } },
+	{ "flood_fill_tiles",   [](const Generation::Stats& s) { return (double)s.floodFillTiles; } },
+	{ "doors",              [](const Generation::Stats& s) { return (double)s.doorsSpawned; } },
+};
+
+struct Summary {
+	double p50, p95, p99, max, mean;
+};
+
+static Summary summarize(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	auto rank = [&](double p) {
+		return NearestRank(values.data(), values.size(), p);
+	};
+	double sum = 0;
+	for (double v : values) sum += v;
+	return Summary{ rank(0.50), rank(0.95), rank(0.99), values.back(), sum / values.size() };
+}
+
+int main(int argc, char** argv) {
+	int runs = 50;
+	unsigned seed = 1;
+	std::string format = "csv";
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--runs" && i + 1 < argc) {
+			runs = std::max(1, atoi(argv[++i]));
+		} else if (arg == "--seed" && i + 1 < argc) {
+			seed = strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--format" && i + 1 < argc) {
+			format = argv[++i];
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--runs N] [--seed S] [--format csv|json]" << std::endl;
+			return 1;
+		}
+	}
+	if (format != "csv" && format != "json") {
+		std::cerr << "unknown format " << format << std::endl;
+		return 1;
+	}
+
+	std::vector<Config> configs;
+	for (auto size : { std::make_pair(64, 64), std::make_pair(128, 72), std::make_pair(128, 128), std::make_pair(256, 256) }) {
+		for (int rooms : { 4, 8, 16 }) {
+			configs.push_back(Config{ size.first, size.second, rooms });
+		}
+	}
+
+	if (format == "csv") {
+		std::cout << "width,height,rooms,runs,metric,p50,p95,p99,max,mean\n";
+	} else {
+		std::cout << "[\n";
+	}
+
+	for (size_t c = 0; c < configs.size(); c++) {
+		const Config& config = configs[c];
+		std::vector<Generation::Stats> results;
+		results.reserve(runs);
+
+		// same seeds for every configuration, so runs stay comparable between builds
+		for (int run = 0; run < runs; run++) {
+			Generation::Stats stats;
+			Generation gen(config.width, config.height, 4, 4, 4, 4);
+			gen.rng.seed(seed + run);
+			gen.stats = &stats;
+			gen.Start(config.rooms, 6, 10, 6, 10);
+			results.push_back(stats);
+		}
+
+		if (format == "json") {
+			std::cout << "  { \"width\": " << config.width << ", \"height\": " << config.height
+				<< ", \"rooms\": " << config.rooms << ", \"runs\": " << runs
+				<< ", \"metrics\": {\n";
+		}
+
+		constexpr size_t metricCount = sizeof(metrics) / sizeof(metrics[0]);
+		for (size_t m = 0; m < metricCount; m++) {
+			std::vector<double> values;
+			values.reserve(results.size());
+			for (const auto& stats : results) {
+				values.push_back(metrics[m].get(stats));
+			}
+			Summary s = summarize(std::move(values));
+
+			if (format == "csv") {
+				std::cout << config.width << ',' << config.height << ',' << config.rooms << ','
+					<< runs << ',' << metrics[m].name << ','
+					<< s.p50 << ',' << s.p95 << ',' << s.p99 << ',' << s.max << ',' << s.mean << '\n';
+			} else {
+				std::cout << "    \"" << metrics[m].name << "\": { \"p50\": " << s.p50 << ", \"p95\": " << s.p95
+					<< ", \"p99\": " << s.p99 << ", \"max\": " << s.max << ", \"mean\": " << s.mean << " }"
+					<< (m + 1 < metricCount ? ",\n" : "\n");
+			}
+		}
+
+		if (format == "json") {
+			std::cout << "  } }" << (c + 1 < configs.size() ? ",\n" : "\n");
+		}
+	}
+
+	if (format == "json") {
+		std::cout << "]\n";
+	}
+	return 0;
+}
@@ -238,6 +238,7 @@ STBIWDEF void stbi_flip_vertically_on_write(int flip_boolean);
 #include <vector>
 #include <iterator>
 #include <algorithm>
+#include <limits>
 #include <string_view>
 #include <iostream>
 #include <stdexcept>
@@ -697,10 +698,123 @@ return color;*/
 
 #include <cstdint>
 #include <type_traits>
+#include <atomic>
+#include <mutex>
 
 namespace cdr {
 
+struct PixelAllocatorStats {
+	/* Buffers handed out */
+	uint64_t allocations{0};
+	/* Buffers that had to be allocated from the system */
+	uint64_t systemAllocations{0};
+	/* Bytes handed out and not given back yet */
+	uint64_t bytesInUse{0};
+	/* Bytes kept around for reuse */
+	uint64_t bytesPooled{0};
+};
+
+// Where bitmaps get their pixels from. Buffers have to be aligned to PixelAlignment bytes.
+class PixelAllocator {
+public:
+	static constexpr size_t PixelAlignment{64};
+
+	virtual ~PixelAllocator() = default;
+	// count is in pixels, Deallocate() gets the same count as Allocate()
+	virtual uint32_t* Allocate(size_t count) = 0;
+	virtual void Deallocate(uint32_t* pixels, size_t count) = 0;
+	PixelAllocatorStats GetStats() const;
+
+protected:
+	std::atomic<uint64_t> allocations{0};
+	std::atomic<uint64_t> systemAllocations{0};
+	std::atomic<uint64_t> bytesInUse{0};
+	std::atomic<uint64_t> bytesPooled{0};
+
+	uint32_t* allocateAligned(size_t count);
+	void deallocateAligned(uint32_t* pixels);
+};
+
+// Every buffer comes from and goes back to the system
+class AlignedPixelAllocator : public PixelAllocator {
+public:
+	uint32_t* Allocate(size_t count) override;
+	void Deallocate(uint32_t* pixels, size_t count) override;
+};
+
+// Keeps freed buffers in size classes and hands them out again, so bitmaps that get created every
+// frame stop allocating after the first one. There are four classes per power of two, so a buffer
+// is at most 25% bigger than asked for. Up to maxPooledBytes are kept.
+class PooledPixelAllocator : public PixelAllocator {
+public:
+	static constexpr size_t DefaultMaxPooledBytes{64 << 20};
+
+	explicit PooledPixelAllocator(size_t maxPooledBytes = DefaultMaxPooledBytes);
+	~PooledPixelAllocator();
+
+	uint32_t* Allocate(size_t count) override;
+	void Deallocate(uint32_t* pixels, size_t count) override;
+	// Gives all pooled buffers back to the system
+	void Trim();
+
+private:
+	// the smallest class is one cache line
+	static constexpr int MinClass{4};
+	static constexpr int SubClassBits{2};
+	// up to 1 << 40 pixels
+	static constexpr int ClassCount{1 + (40 - MinClass) * (1 << SubClassBits)};
+
+	size_t maxPooledBytes;
+	std::mutex mutex;
+	std::vector<uint32_t*> pool[ClassCount];
+
+	static int sizeClass(size_t count);
+	static size_t classCapacity(int sizeClass);
+};
+
+// The allocator for bitmaps created from now on, nullptr goes back to the default pool.
+// Bitmaps give their pixels back to the allocator they got them from, it has to outlive them.
+void SetPixelAllocator(PixelAllocator* allocator);
+PixelAllocator& GetPixelAllocator();
+
+// Converts count pixels of 1 (grey), 2 (grey, alpha), 3 (RGB) or 4 (RGBA) bytes each, like stb_image
+// returns them, to packed RGBA
+void ConvertToRGBA(const uint8_t* source, int components, uint32_t* destination, size_t count);
+// Packed RGBA to R, G, B, A in memory order (ABGR on little endian) and back, source can be destination
+void SwapRGBAtoABGR(const uint32_t* source, uint32_t* destination, size_t count);
+// Big conversions, mips and tiled copies are split into row bands over several threads. Threads
+// that already run next to others, like the workers of a loader, turn that off for themselves.
+void SetParallelConversion(bool enable);
+
+// None leaves the pixels uninitialized, for bitmaps that get overwritten completely anyway
+enum class BitmapInit {
+	Zero,
+	None,
+};
+
+class BitmapView;
+
+// Tiled layout: the pixels in TileSize x TileSize blocks, tiles row by row, pixels inside a tile
+// row by row. Neighbours in any direction are close in memory, so sampling along a rotated line
+// stays in a few cache lines instead of touching a new row every pixel.
+constexpr int TileSize{8};
+// x and y have to be inside the bitmap
+inline size_t TiledIndex(int x, int y, int width) {
+	size_t tilesX = ((unsigned)width + TileSize - 1) / TileSize;
+	return (((unsigned)y / TileSize) * tilesX + (unsigned)x / TileSize) * (TileSize * TileSize) + ((unsigned)y % TileSize) * TileSize + (unsigned)x % TileSize;
+}
+// pixels of a tiled copy, the tiles on the right and bottom edge are padded to full tiles
+inline size_t TiledPixelCount(int width, int height) {
+	return (size_t)((width + TileSize - 1) / TileSize) * ((height + TileSize - 1) / TileSize) * TileSize * TileSize;
+}
+// destination has room for TiledPixelCount() pixels, the padding is zeroed
+void ConvertToTiled(const BitmapView& source, uint32_t* destination);
+// pitch 0 means the rows are tightly packed
+void ConvertFromTiled(const uint32_t* source, int width, int height, uint32_t* destination, int pitch = 0);
+
 class BaseBitmap {
+	friend class BitmapView;
+	
 protected:
 	/* Individual pixels of the bitmap */
 	uint32_t* data{nullptr};
@@ -708,8 +822,23 @@ protected:
 	int width{0};
 	/* Height of the bitmap */
 	int height{0};
+	/* Distance between two rows in pixels */
+	int pitch{0};
 	/* Num of components*/
 	int components;
+	/* Allocator the pixels came from */
+	PixelAllocator* allocator{nullptr};
+	/* Downscaled copies, all levels in one allocation from the same allocator */
+	uint32_t* mipData{nullptr};
+	size_t mipPixels{0};
+	std::vector<BitmapView> mips;
+	/* Tiled copy of the pixels for rotated sampling, built by MakeTiled() */
+	uint32_t* tiledData{nullptr};
+	bool tiledDirty{true};
+	
+	void allocate();
+	void release();
+	void copyMips(const BaseBitmap& other);
 	
 public:
 	enum class Formats {
@@ -719,7 +848,8 @@ public:
 		JPG,
 	};
 	
-	BaseBitmap(int width, int height, int numComponents = 4);
+	// pitch 0 means the rows are tightly packed
+	BaseBitmap(int width, int height, int numComponents = 4, BitmapInit init = BitmapInit::Zero, int pitch = 0);
 	BaseBitmap(uint32_t* source, int sourceWidth, int sourceHeight, int sourceComponents);
 	BaseBitmap(std::string_view file, int reqComponents = 0);
 	virtual ~BaseBitmap();
@@ -731,20 +861,46 @@ public:
 
 	inline int GetWidth() const { return width; }
 	inline int GetHeight() const { return height; }
-	inline uint32_t* GetData() { return data; }
+	inline int GetPitch() const { return pitch; }
+	// NOTE: assumes the pixels get written, which makes the tiled copy stale
+	inline uint32_t* GetData() { tiledDirty = true; return data; }
 	inline const uint32_t* GetData() const { return data; }
-	inline uint32_t GetRawPixel(int x, int y) const { return data[x + y * width]; }
-	inline void SetRawPixel(uint32_t value, int x, int y) { data[x + y * width] = value; }
-	inline void SetRawPixel(uint8_t r, uint8_t g, uint8_t b, uint8_t a, int x, int y) { data[x + y * width] = (r << 24) + (g << 16) + (b << 8) + a; }
+	inline uint32_t GetRawPixel(int x, int y) const { return data[x + y * pitch]; }
+	inline void SetRawPixel(uint32_t value, int x, int y) { tiledDirty = true; data[x + y * pitch] = value; }
+	inline void SetRawPixel(uint8_t r, uint8_t g, uint8_t b, uint8_t a, int x, int y) { tiledDirty = true; data[x + y * pitch] = (r << 24) + (g << 16) + (b << 8) + a; }
+	
+	// Pitch with rows that start on a PixelAllocator::PixelAlignment boundary, for SIMD loads
+	static constexpr int AlignedPitch(int width) {
+		constexpr int pixels = PixelAllocator::PixelAlignment / sizeof(uint32_t);
+		return (width + pixels - 1) / pixels * pixels;
+	}
 	
 	void SaveAs(const std::string& fileName, Formats format, int quality = 100);
+	
+	// Builds the mip chain: copies that are half as big as the level before, down to 1x1 or until
+	// there are maxLevels levels (this one included, 0 means all of them). Renderers sample them
+	// when minifying. They aren't updated when the pixels change, generate them again then.
+	void GenerateMips(int maxLevels = 0);
+	void ClearMips();
+	// levels including this one, 1 without mips
+	int GetMipCount() const;
+
+	// Builds the copy of the pixels in the tiled layout (see TiledIndex()), or brings it up to date
+	// after the pixels changed. Renderers sample it when they draw the bitmap rotated. Like the mips
+	// it's built before the bitmap gets shared, reading it never changes the bitmap.
+	void MakeTiled();
+	// nullptr without MakeTiled() or when the pixels changed since
+	const uint32_t* GetTiled() const;
+	// For pixels written through a pointer from GetData() that was kept around
+	inline void MarkDirty() { tiledDirty = true; }
+	void ClearTiled();
 };
 
 class RGBABitmap : public BaseBitmap {
 	static constexpr int components{4};
 	
 public:
-	RGBABitmap(int width, int height);
+	RGBABitmap(int width, int height, BitmapInit init = BitmapInit::Zero, int pitch = 0);
 	RGBABitmap(uint32_t* source, int sourceWidth, int sourceHeight);
 	RGBABitmap(std::string_view file);
 	~RGBABitmap();
@@ -756,10 +912,11 @@ public:
 	RGBABitmap& operator=(RGBABitmap&& other) noexcept;
 	
 	inline RGBA GetPixel(int x, int y) const {
-		return RGBA{data[x + y * width]};
+		return RGBA{data[x + y * pitch]};
 	}
 	inline void SetPixel(const RGB& value, int x, int y) {
-		data[x + y * width] = RGBtoUINT(value);
+		tiledDirty = true;
+		data[x + y * pitch] = RGBtoUINT(value);
 	}
 };
 
@@ -767,7 +924,7 @@ class RGBBitmap : public BaseBitmap {
 	static constexpr int components{3};
 	
 public:
-	RGBBitmap(int width, int height);
+	RGBBitmap(int width, int height, BitmapInit init = BitmapInit::Zero, int pitch = 0);
 	RGBBitmap(uint32_t* source, int sourceWidth, int sourceHeight);
 	RGBBitmap(std::string_view file);
 	~RGBBitmap();
@@ -779,10 +936,11 @@ public:
 	RGBBitmap& operator=(RGBBitmap&& other) noexcept;
 	
 	inline RGB GetPixel(int x, int y) const {
-		return RGB{data[x + y * width]};
+		return RGB{data[x + y * pitch]};
 	}
 	inline void SetPixel(const RGB& value, int x, int y) {
-		data[x + y * width] = RGBtoUINT(value);
+		tiledDirty = true;
+		data[x + y * pitch] = RGBtoUINT(value);
 	}
 };
 
@@ -826,6 +984,76 @@ public:
 
 using Bitmap = RGBABitmap;
 
+// Non-owning view of RGBA pixels: a bitmap, a sub-rectangle of one or a render target.
+// Nothing gets copied, the pixels have to outlive the view.
+class BitmapView {
+	const uint32_t* data{nullptr};
+	int width{0};
+	int height{0};
+	/* Distance between two rows in pixels */
+	int pitch{0};
+	/* Levels 1 and up of the mip chain, owned by whoever owns the pixels */
+	const BitmapView* mips{nullptr};
+	int mipCount{0};
+	/* The bitmap the pixels belong to, for its tiled copy */
+	const BaseBitmap* owner{nullptr};
+	/* The same pixels in the tiled layout, if the view reads from there */
+	const uint32_t* tiled{nullptr};
+
+public:
+	BitmapView() = default;
+	// pitch 0 means the rows are tightly packed
+	BitmapView(const uint32_t* data, int width, int height, int pitch = 0) : data{data}, width{width}, height{height}, pitch{pitch ? pitch : width} {}
+	BitmapView(const BaseBitmap& bitmap) : BitmapView(bitmap.GetData(), bitmap.GetWidth(), bitmap.GetHeight(), bitmap.GetPitch()) {
+		mips = bitmap.mips.data();
+		mipCount = bitmap.mips.size();
+		owner = &bitmap;
+	}
+
+	inline int GetWidth() const { return width; }
+	inline int GetHeight() const { return height; }
+	inline int GetPitch() const { return pitch; }
+	// always the row by row pixels, even if the view is tiled
+	inline const uint32_t* GetData() const { return data; }
+	inline uint32_t GetRawPixel(int x, int y) const { return tiled ? tiled[TiledIndex(x, y, width)] : data[x + y * pitch]; }
+	inline RGBA GetPixel(int x, int y) const { return RGBA{GetRawPixel(x, y)}; }
+
+	// The same view reading single pixels from the tiled copy of its bitmap. Views that don't
+	// belong to a whole bitmap (sub views, mips, mapped files) or whose bitmap has no up to date
+	// tiled copy (see BaseBitmap::MakeTiled()) stay as they are.
+	inline BitmapView Tiled() const {
+		if (!owner || tiled) return *this;
+		BitmapView view{*this};
+		view.tiled = owner->GetTiled();
+		return view;
+	}
+	inline bool IsTiled() const { return tiled != nullptr; }
+
+	// levels including this one, 1 without mips
+	inline int GetMipCount() const { return 1 + mipCount; }
+	// Level 0 is the view itself, levels past the last one are the last one. Mips don't have mips.
+	inline BitmapView GetMip(int level) const {
+		if (level <= 0 || mipCount == 0) return *this;
+		return mips[std::min(level, mipCount) - 1];
+	}
+	// The same pixels with levels 1 and up of a mip chain that's stored somewhere else
+	inline BitmapView WithMips(const BitmapView* levels, int count) const {
+		BitmapView view{data, width, height, pitch};
+		view.mips = count > 0 ? levels : nullptr;
+		view.mipCount = count > 0 ? count : 0;
+		return view;
+	}
+	
+	// The part of the view inside the rectangle, shares the pixels, but not the mips
+	inline BitmapView SubView(int x, int y, int width, int height) const {
+		int left = std::clamp(x, 0, this->width);
+		int top = std::clamp(y, 0, this->height);
+		int right = std::clamp(x + width, left, this->width);
+		int bottom = std::clamp(y + height, top, this->height);
+		return BitmapView{data + left + top * pitch, right - left, bottom - top, pitch};
+	}
+};
+
 }
 
 #endif
@@ -1497,6 +1725,78 @@ struct FRectangle {
 
 #pragma endregion POINT_HPP
 
+#pragma region ATLAS_HPP
+/********************************
+ * Project: Cidr                *
+ * File: atlas.hpp              *
+ * Date: 19.10.2026             *
+ ********************************/
+
+#ifndef CIDR_ATLAS_HPP
+#define CIDR_ATLAS_HPP
+
+namespace cdr {
+
+// A rectangle of a texture atlas. The view follows the atlas' pixels, so a sprite stays valid
+// when the atlas is moved, but not after it's destroyed or cleared.
+struct Sprite {
+	BitmapView atlas;
+	Rectangle rect;
+	
+	inline bool IsValid() const { return atlas.GetData() != nullptr; }
+	inline int GetWidth() const { return rect.width; }
+	inline int GetHeight() const { return rect.height; }
+	// just the pixels of the sprite, without the rest of the atlas
+	inline BitmapView GetView() const { return atlas.SubView(rect.x, rect.y, rect.width, rect.height); }
+};
+
+// Packs many small bitmaps into one big one with a skyline packer, so drawing sprites one after
+// another reads from a single allocation instead of jumping between bitmaps.
+class TextureAtlas {
+public:
+	// sprites start on a multiple of this many pixels, so their rows are 16 byte aligned
+	static constexpr int SpriteAlignment{4};
+	// transparent pixels right of and below every sprite
+	static constexpr int DefaultPadding{1};
+	
+	TextureAtlas(int width, int height, int padding = DefaultPadding);
+	
+	// Copies the bitmap into the atlas, the sprite is invalid if there's no room left for it
+	Sprite Add(const BitmapView& bitmap);
+	// Adds the tallest bitmaps first, which packs tighter than adding them in any order.
+	// The sprites are in the same order as the bitmaps.
+	std::vector<Sprite> Add(const std::vector<BitmapView>& bitmaps);
+	// Removes every sprite, the ones handed out before show whatever gets added next
+	void Clear();
+	
+	inline const RGBABitmap& GetBitmap() const { return bitmap; }
+	inline int GetSpriteCount() const { return spriteCount; }
+	// fraction of the atlas covered by sprites
+	float GetOccupancy() const;
+	
+private:
+	// the lowest free row of a run of columns
+	struct SkylineSegment {
+		int x;
+		int y;
+		int width;
+	};
+	
+	RGBABitmap bitmap;
+	int padding;
+	std::vector<SkylineSegment> skyline;
+	size_t usedPixels{0};
+	int spriteCount{0};
+	
+	bool findPosition(int width, int height, int& x, int& y, size_t& segment) const;
+	void place(size_t segment, int x, int y, int width, int height);
+};
+
+}
+
+#endif
+#pragma endregion ATLAS_HPP
+
 #pragma region RENDERER_HPP
 /********************************
  * Project: Cidr                *
@@ -1526,7 +1826,17 @@ public:
 	RGBA ClampToBorderColor {};
 
 	/* CONSTRUCTOR - DESTRUCTOR */
-	Renderer(uint32_t* pixels, int width, int height);
+	// pitch is the distance between two rows in pixels, 0 means the rows are tightly packed
+	Renderer(uint32_t* pixels, int width, int height, int pitch = 0);
+	// Renders into the pixels of the bitmap, which has to outlive the renderer
+	explicit Renderer(BaseBitmap& target);
+	
+	// Points the renderer at another pixel buffer, e.g. a texture that got locked again
+	void SetTarget(uint32_t* pixels, int width, int height, int pitch = 0);
+	// A renderer for the part of the target inside the rectangle (clipped), with its origin at x, y.
+	// Shares the pixels and the settings, damage is tracked separately in its own coordinates.
+	Renderer SubView(int x, int y, int width, int height) const;
+	inline Renderer SubView(Rectangle rectangle) const { return SubView(rectangle.x, rectangle.y, rectangle.width, rectangle.height); }
 	
 	/* CLEAR FUNCTIONS */ 
 	void Clear();
@@ -1546,12 +1856,14 @@ public:
 	void FillTriangle(const RGBA& color, Point p1, Point p2, Point p3);
 	void FillTriangle(RGBA color1, RGBA color2, RGBA color3, Point p1, Point p2, Point p3);
 	void FillTriangle(RGBA (*shader)(const Renderer& renderer, int x, int y), Point p1, Point p2, Point p3);
-	void DrawBitmap(const Bitmap& bitmap, float destX, float destY, int destWidth, int destHeight, float srcX, float srcY, int srcWidth, int srcHeight);
+	void DrawBitmap(const BitmapView& bitmap, float destX, float destY, int destWidth, int destHeight, float srcX, float srcY, int srcWidth, int srcHeight);
+	// Scaled to destWidth x destHeight and rotated by angle (radians, clockwise) around its centre
+	void DrawBitmap(const BitmapView& bitmap, float centreX, float centreY, int destWidth, int destHeight, float angle);
 	void DrawGlyph(uint8_t glyph, int x, int y, const TextStyle& ts);
 	void DrawText(const std::string_view text, const TextStyle& ts);
 	void DrawText(const std::string_view text, int x, int y, const TextStyle& ts);
-	void DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2, FPoint tp3, FPoint p1, FPoint p2, FPoint p3);
-	void ApplyMask(const cdr::Bitmap& mask, bool invert = false);
+	void DrawTriangle(const BitmapView& texture, FPoint tp1, FPoint tp2, FPoint tp3, FPoint p1, FPoint p2, FPoint p3);
+	void ApplyMask(const cdr::BitmapView& mask, bool invert = false);
 	
 	/* DRAWING FUNCTION OVERLOADS */
 		   void DrawPixel(const RGBA& color, int x, int y);
@@ -1563,11 +1875,15 @@ public:
 	inline void FillCircle(const RGBA& color, int centreX, int centreY, int radius, bool AA = false) { FillCircle(color, Point{centreX,centreY}, radius, AA); }
 	inline void FillCircle(RGBA (*shader)(const Renderer& renderer, int x, int y), int centreX, int centreY, int radius, bool AA = false) { FillCircle(shader, Point{centreX,centreY}, radius, AA); }
 	inline void DrawTriangle(const RGBA& color, int x1, int y1, int x2, int y2, int x3, int y3, bool AA = false, bool GC = false) { DrawTriangle(color, Point{x1, y1}, Point{x2, y2}, Point{x3, y3}, AA, GC ); }
-	inline void DrawTriangle(const Bitmap& texture, float tx1, float ty1, float tx2, float ty2, float tx3, float ty3, float x1, float y1, float x2, float y2, float x3, float y3) { DrawTriangle(texture, FPoint{tx1, ty1}, FPoint{tx2, ty2}, FPoint{tx3, ty3}, FPoint{x1, y1}, FPoint{x2, y2}, FPoint{x3, y3}); }
+	inline void DrawTriangle(const BitmapView& texture, float tx1, float ty1, float tx2, float ty2, float tx3, float ty3, float x1, float y1, float x2, float y2, float x3, float y3) { DrawTriangle(texture, FPoint{tx1, ty1}, FPoint{tx2, ty2}, FPoint{tx3, ty3}, FPoint{x1, y1}, FPoint{x2, y2}, FPoint{x3, y3}); }
 	inline void FillTriangle(const RGBA& color, int x1, int y1, int x2, int y2, int x3, int y3) { FillTriangle(color, Point{x1, y1}, Point{x2, y2}, Point{x3, y3} ); }
 	inline void FillTriangle(RGBA color1, RGBA color2, RGBA color3, int x1, int y1, int x2, int y2, int x3, int y3) { FillTriangle(color1, color2, color3, Point{x1, y1}, Point{x2, y2}, Point{x3, y3}); }
 	inline void FillTriangle(RGBA (*shader)(const Renderer& renderer, int x, int y), int x1, int y1, int x2, int y2, int x3, int y3) { FillTriangle(shader, Point{x1, y1}, Point{x2, y2}, Point{x3, y3} ); }
-	inline void DrawBitmap(const Bitmap& bitmap, FPoint destLocation, int destWidth, int destHeight, FPoint srcLocation, int srcWidth, int srcHeight) { DrawBitmap(bitmap, destLocation.x, destLocation.y, destWidth, destHeight, srcLocation.x, srcLocation.y, srcWidth, srcHeight); }
+	// Copies the sprite unscaled, straight from its atlas. Alpha is handled like DrawPixel() does.
+	void DrawSprite(const Sprite& sprite, int x, int y);
+	// Scaled like DrawBitmap(), edges are clamped to the sprite, not the rest of the atlas
+	void DrawSprite(const Sprite& sprite, float x, float y, int width, int height);
+	inline void DrawBitmap(const BitmapView& bitmap, FPoint destLocation, int destWidth, int destHeight, FPoint srcLocation, int srcWidth, int srcHeight) { DrawBitmap(bitmap, destLocation.x, destLocation.y, destWidth, destHeight, srcLocation.x, srcLocation.y, srcWidth, srcHeight); }
 	inline void DrawGlyph(uint8_t glyph, int x, int y) { DrawGlyph(glyph, x, y, textStyle); }
 	inline void DrawText(const std::string_view text) { DrawText(text, textStyle); };
 	inline void DrawText(const std::string_view text, int x, int y) { DrawText(text, x, y, textStyle); };
@@ -1581,7 +1897,7 @@ public:
 	inline void DrawTriangle(uint32_t color, const Point& p1, const Point& p2, const Point& p3, bool AA = false, bool GC = false) { DrawTriangle(RGBA{color}, p1, p2, p3, AA, GC ); }
 	inline void FillTriangle(uint32_t color, const Point& p1, Point p2, Point p3) { FillTriangle(RGBA{color}, p1, p2, p3 ); }
 	inline void FillTriangle(uint32_t color1, uint32_t color2, uint32_t color3, Point p1, Point p2, Point p3) { FillTriangle(RGBA{color1}, RGBA{color2}, RGBA{color3}, p1, p2, p3); }
-	inline void DrawBitmap(const Bitmap& bitmap, FRectangle destRect, FRectangle srcRect) { DrawBitmap(bitmap, destRect.x, destRect.y, destRect.width, destRect.height, srcRect.x, srcRect.y, srcRect.width, srcRect.height); }
+	inline void DrawBitmap(const BitmapView& bitmap, FRectangle destRect, FRectangle srcRect) { DrawBitmap(bitmap, destRect.x, destRect.y, destRect.width, destRect.height, srcRect.x, srcRect.y, srcRect.width, srcRect.height); }
 	inline void DrawGlyph(uint8_t glyph, Point p, const TextStyle& ts) { DrawGlyph(glyph, p.x, p.y, ts); };
 
 	inline void DrawPixel(uint32_t color, int x, int y);
@@ -1605,6 +1921,13 @@ public:
 	inline int GetHeight() const {
 		return height;
 	}
+	inline int GetPitch() const {
+		return pitch;
+	}
+	// the render target, e.g. to draw it into another one without copying it first
+	inline BitmapView GetView() const {
+		return BitmapView{pixels, width, height, pitch};
+	}
 	inline cdr::RGBA GetPixel(const Point& p) const {
 		if(p.x < 0 || p.y < 0 || p.x >= GetWidth() || p.y >= GetHeight()) return cdr::RGBA{};
 		return cdr::RGBA{pixels[getIndex(p)]};
@@ -1633,12 +1956,27 @@ public:
 	/* Toggles */
 	inline void EnableAlphaBlending() { useAlphaBlending = true; }
 	inline void DisableAlphaBlending() { useAlphaBlending = true; }
+	// Every drawing call adds the area it touched to GetDamage(), touching rectangles are merged.
+	// Useful to only upload what changed, ClearDamage() after the upload.
+	inline void EnableDamageTracking() { trackDamage = true; }
+	inline void DisableDamageTracking() { trackDamage = false; damage.clear(); }
+	
+	/* DAMAGE TRACKING */
+	inline const std::vector<Rectangle>& GetDamage() const { return damage; }
+	inline void ClearDamage() { damage.clear(); }
+	// for drawing that didn't go through the renderer
+	void AddDamage(Rectangle rectangle);
 	
 private:
 	uint32_t* pixels {nullptr};
 	int width {0};
 	int height {0};
-	bool useAlphaBlending;
+	int pitch {0};
+	// the bitmap the pixels belong to, if the renderer was made for one, to keep its tiled copy up to date
+	BaseBitmap* targetBitmap {nullptr};
+	bool useAlphaBlending {false};
+	bool trackDamage {false};
+	std::vector<Rectangle> damage;
 	// NOTE: text rendering related member variables
 	int globalX;
 	int globalY;
@@ -1647,16 +1985,28 @@ private:
 private:
 	/* UTILITY FUNCTIONS */
 	inline int getIndex(const Point& p) const {
-		return p.x + p.y * width;
+		return p.x + p.y * pitch;
 	}
 	inline int getIndex(int x, int y) const {
-		return x + y * width;
+		return x + y * pitch;
 	}
+	inline void addDamage(int x, int y, int width, int height) {
+		if (targetBitmap) targetBitmap->MarkDirty();
+		if (trackDamage) AddDamage(Rectangle{x, y, width, height});
+	}
+	// DrawPixel() without the damage, the drawing calls add the area they touch once
+	void drawPixel(const RGBA& color, const Point& p);
+	void drawPixel(const RGBA& color, int x, int y);
+	inline void drawPixel(uint32_t color, int x, int y);
 	void drawScanLine(uint32_t color, int startX, int endX, int y);
 	void drawScanLine(const RGBA& color1, const RGBA& color2, int startX, int endX, int y);
 	bool clampCoords(float& x, float& y, int width, int height) const;
-	RGBA sampleTexture(const cdr::Bitmap& b, float x, float y) const;
-	uint32_t sampleTextureRaw(const cdr::Bitmap& b, float x, float y) const;
+	RGBA sampleTexture(const cdr::BitmapView& b, float x, float y) const;
+	// x and y are in texels of level 0, lod is log2 of the texels per pixel
+	RGBA sampleTextureLod(const cdr::BitmapView& b, float x, float y, float lod) const;
+	// The mip to read for lod and, for trilinear filtering, the next smaller one to blend in by blend
+	void selectMips(const cdr::BitmapView& b, float lod, cdr::BitmapView& level, cdr::BitmapView& next, float& blend) const;
+	uint32_t sampleTextureRaw(const cdr::BitmapView& b, float x, float y) const;
 	bool clampCoords(int& x, int& y, int width, int height) const;
 };
 
@@ -1761,6 +2111,16 @@ inline RGBA alphaBlendColor(uint32_t color1, uint32_t color2) {
 #ifdef CIDR_IMPLEMENTATION
 #undef CIDR_IMPLEMENTATION
 
+// SIMD paths for pixel conversion, mips and sprites
+#if defined(__SSSE3__)
+# include <tmmintrin.h>
+# define CIDR_SSE2
+# define CIDR_SSSE3
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define CIDR_SSE2
+#endif
+
 #pragma region RENDERER_CPP
 /********************************
  * Project: Cidr                *
@@ -1776,59 +2136,151 @@ inline RGBA alphaBlendColor(uint32_t color1, uint32_t color2) {
 #include <array>
 #include <thread>
 
+// Define CIDR_PROFILE_ZONE(name) before the implementation to time the bigger drawing calls
+// with your own profiler, it has to measure until the end of the enclosing scope
+#ifndef CIDR_PROFILE_ZONE
+#define CIDR_PROFILE_ZONE(name)
+#endif
+
 static inline double lerp(double a, double b, double t) {
 	return a + t * (b - a);
 }
 
-cdr::Renderer::Renderer(uint32_t* pixels, int width, int height) 
+cdr::Renderer::Renderer(uint32_t* pixels, int width, int height, int pitch) 
 	: pixels{pixels}, 
 	width{width}, 
 	height{height},
+	pitch{pitch ? pitch : width},
 	globalX(0), globalY(0) {
 }
 
+cdr::Renderer::Renderer(BaseBitmap& target) 
+	: Renderer(target.GetData(), target.GetWidth(), target.GetHeight(), target.GetPitch()) {
+	targetBitmap = &target;
+}
+
+void cdr::Renderer::SetTarget(uint32_t* pixels, int width, int height, int pitch) {
+	targetBitmap = nullptr;
+	this->pixels = pixels;
+	this->width = width;
+	this->height = height;
+	this->pitch = pitch ? pitch : width;
+}
+
+cdr::Renderer cdr::Renderer::SubView(int x, int y, int width, int height) const {
+	int left = std::clamp(x, 0, this->width);
+	int top = std::clamp(y, 0, this->height);
+	int right = std::clamp(x + width, left, this->width);
+	int bottom = std::clamp(y + height, top, this->height);
+	
+	Renderer view{*this};
+	view.SetTarget(pixels + getIndex(left, top), right - left, bottom - top, pitch);
+	// still drawing into the same bitmap
+	view.targetBitmap = targetBitmap;
+	view.damage.clear();
+	view.globalX = view.globalY = 0;
+	return view;
+}
+
+void cdr::Renderer::AddDamage(Rectangle rectangle) {
+	int x1 = std::max(rectangle.x, 0);
+	int y1 = std::max(rectangle.y, 0);
+	int x2 = std::min(rectangle.x + rectangle.width, width);
+	int y2 = std::min(rectangle.y + rectangle.height, height);
+	if (x1 >= x2 || y1 >= y2) return;
+	
+	if (!damage.empty()) {
+		Rectangle& last = damage.back();
+		int lx2 = last.x + last.width;
+		int ly2 = last.y + last.height;
+		// most drawing calls damage the same or the next pixels as the call before
+		if (x1 >= last.x && y1 >= last.y && x2 <= lx2 && y2 <= ly2) return;
+		int ux1 = std::min(x1, last.x);
+		int uy1 = std::min(y1, last.y);
+		int ux2 = std::max(x2, lx2);
+		int uy2 = std::max(y2, ly2);
+		// merge if the union doesn't cover anything that isn't damaged (when they line up)
+		if ((ux2 - ux1) * (uy2 - uy1) <= last.width * last.height + (x2 - x1) * (y2 - y1)) {
+			last = Rectangle{ux1, uy1, ux2 - ux1, uy2 - uy1};
+			return;
+		}
+	}
+	damage.push_back(Rectangle{x1, y1, x2 - x1, y2 - y1});
+}
+
 void cdr::Renderer::Clear() {
-	memset(pixels, 0, width * height * sizeof(uint32_t));
+	CIDR_PROFILE_ZONE("Renderer::Clear");
+	addDamage(0, 0, width, height);
+	if (pitch == width) {
+		memset(pixels, 0, width * height * sizeof(uint32_t));
+	} else {
+		for (int y = 0; y < height; y++) {
+			memset(pixels + getIndex(0, y), 0, width * sizeof(uint32_t));
+		}
+	}
 	globalX = globalY = 0;
 }
 void cdr::Renderer::Clear(const RGBA& color) {
 	Clear(RGBtoUINT(color));
 }
 void cdr::Renderer::Clear(uint32_t color) {
-	std::fill(pixels, pixels + width * height, color);
+	CIDR_PROFILE_ZONE("Renderer::Clear");
+	addDamage(0, 0, width, height);
+	if (pitch == width) {
+		std::fill(pixels, pixels + width * height, color);
+	} else {
+		for (int y = 0; y < height; y++) {
+			std::fill_n(pixels + getIndex(0, y), width, color);
+		}
+	}
 	globalX = globalY = 0;
 }
 
 void cdr::Renderer::DrawPixel(const cdr::RGBA& color, const Point& p) {
+	addDamage(p.x, p.y, 1, 1);
+	drawPixel(color, p);
+}
+void cdr::Renderer::DrawPixel(const cdr::RGBA& color, int x, int y) {
+	addDamage(x, y, 1, 1);
+	drawPixel(color, x, y);
+}
+void cdr::Renderer::DrawPixel(uint32_t color, int x, int y) {
+	addDamage(x, y, 1, 1);
+	drawPixel(color, x, y);
+}
+void cdr::Renderer::drawPixel(const cdr::RGBA& color, const Point& p) {
 	if(!useAlphaBlending && color.a != 0)
 		pixels[getIndex(p.x, p.y)] = RGBtoUINT(color);
 	else
 		pixels[getIndex(p.x, p.y)] = RGBtoUINT(alphaBlendColor(pixels[getIndex(p.x, p.y)], RGBtoUINT(color)));
 }
-void cdr::Renderer::DrawPixel(const cdr::RGBA& color, int x, int y) {
+void cdr::Renderer::drawPixel(const cdr::RGBA& color, int x, int y) {
 	if(!useAlphaBlending && color.a != 0)
 		pixels[getIndex(x, y)] = RGBtoUINT(color);
 	else
 		pixels[getIndex(x, y)] = RGBtoUINT(alphaBlendColor(pixels[getIndex(x, y)], RGBtoUINT(color)));
 }
-void cdr::Renderer::DrawPixel(uint32_t color, int x, int y) {
+void cdr::Renderer::drawPixel(uint32_t color, int x, int y) {
 	if (!useAlphaBlending && (color & 0xff) != 0)
 		pixels[getIndex(x, y)] = color;
 	else
 		pixels[getIndex(x, y)] = RGBtoUINT(alphaBlendColor(pixels[getIndex(x, y)], color));
 }
 
-void cdr::Renderer::ApplyMask(const cdr::Bitmap& mask, bool invert) {
+void cdr::Renderer::ApplyMask(const cdr::BitmapView& mask, bool invert) {
+	CIDR_PROFILE_ZONE("Renderer::ApplyMask");
 	if (mask.GetWidth() != this->GetWidth() || mask.GetHeight() != this->GetHeight()) return;
+	addDamage(0, 0, width, height);
 	
-	for (int i = 0; i < this->GetWidth() * this->GetHeight(); i++) {
+	for (int j = 0; j < this->GetWidth() * this->GetHeight(); j++) {
+		int i = getIndex(j % width, j / width);
 		uint8_t source_r = getR(pixels[i]);
 		uint8_t source_g = getG(pixels[i]);
 		uint8_t source_b = getB(pixels[i]);
 
-		uint8_t mask_r = getR(mask.GetRawPixel(i % mask.GetWidth(), i / mask.GetWidth()));
-		uint8_t mask_g = getG(mask.GetRawPixel(i % mask.GetWidth(), i / mask.GetWidth()));
-		uint8_t mask_b = getB(mask.GetRawPixel(i % mask.GetWidth(), i / mask.GetWidth()));
+		uint8_t mask_r = getR(mask.GetRawPixel(j % mask.GetWidth(), j / mask.GetWidth()));
+		uint8_t mask_g = getG(mask.GetRawPixel(j % mask.GetWidth(), j / mask.GetWidth()));
+		uint8_t mask_b = getB(mask.GetRawPixel(j % mask.GetWidth(), j / mask.GetWidth()));
 
 		uint8_t result_r = source_r * (invert ? 255 - mask_r : mask_r) / 255;
 		uint8_t result_g = source_g * (invert ? 255 - mask_g : mask_g) / 255;
@@ -1844,6 +2296,8 @@ void cdr::Renderer::ApplyMask(const cdr::Bitmap& mask, bool invert) {
 
 // TODO: Add clipping
 void cdr::Renderer::DrawLine(const cdr::RGBA& color, const Point& start, const Point& end, bool AA, bool GC) {
+	// NOTE: anti aliasing touches the pixels next to the line too
+	addDamage(std::min(start.x, end.x) - 1, std::min(start.y, end.y) - 1, std::abs(end.x - start.x) + 3, std::abs(end.y - start.y) + 3);
 	// calculate delta lengths
 	int dx {end.x - start.x}; 
 	int dy {end.y - start.y};
@@ -1860,7 +2314,7 @@ void cdr::Renderer::DrawLine(const cdr::RGBA& color, const Point& start, const P
 		
 		for(int i {0}; i < biggest; i++) {
 			// Plot point in current location 
-			DrawPixel(color, std::round(p.x), std::round(p.y));
+			drawPixel(color, std::round(p.x), std::round(p.y));
 			// step further in line 
 			p += step;
 		}
@@ -1879,12 +2333,12 @@ void cdr::Renderer::DrawLine(const cdr::RGBA& color, const Point& start, const P
 					RGBA result2 {alphaBlendColorGammaCorrected(GetPixel(p.x, p.y),     color, AAValue2 * 255.f)};
 					result1.a = result1.a * color.a / 255.f;
 					result2.a = result2.a * color.a / 255.f;
-					DrawPixel(alphaBlendColor(GetPixel(p.x + 1, p.y), result1, result1.a), p.x + 1, p.y);
-					DrawPixel(alphaBlendColor(GetPixel(p.x, p.y),     result2, result2.a), p.x,     p.y);
+					drawPixel(alphaBlendColor(GetPixel(p.x + 1, p.y), result1, result1.a), p.x + 1, p.y);
+					drawPixel(alphaBlendColor(GetPixel(p.x, p.y),     result2, result2.a), p.x,     p.y);
 				}
 				else {
-					DrawPixel(alphaBlendColor(GetPixel(p.x + 1, p.y), color, AAValue1 * color.a), p.x + 1, p.y);
-					DrawPixel(alphaBlendColor(GetPixel(p.x,     p.y), color, AAValue2 * color.a), p.x,     p.y); 
+					drawPixel(alphaBlendColor(GetPixel(p.x + 1, p.y), color, AAValue1 * color.a), p.x + 1, p.y);
+					drawPixel(alphaBlendColor(GetPixel(p.x,     p.y), color, AAValue2 * color.a), p.x,     p.y); 
 				}
 			}
 			// line is shallow
@@ -1898,12 +2352,12 @@ void cdr::Renderer::DrawLine(const cdr::RGBA& color, const Point& start, const P
 					RGBA result2 {alphaBlendColorGammaCorrected(GetPixel(p.x, p.y),     color, AAValue2 * 255.f)};
 					result1.a = result1.a * color.a / 255.f;
 					result2.a = result2.a * color.a / 255.f;
-					DrawPixel(alphaBlendColor(GetPixel(p.x, p.y + 1), result1, result1.a), p.x, p.y + 1);
-					DrawPixel(alphaBlendColor(GetPixel(p.x, p.y),     result2, result2.a), p.x, p.y);
+					drawPixel(alphaBlendColor(GetPixel(p.x, p.y + 1), result1, result1.a), p.x, p.y + 1);
+					drawPixel(alphaBlendColor(GetPixel(p.x, p.y),     result2, result2.a), p.x, p.y);
 				}
 				else {
-					DrawPixel(alphaBlendColor(GetPixel(p.x, p.y + 1), color, AAValue1 * color.a), p.x, p.y + 1);
-					DrawPixel(alphaBlendColor(GetPixel(p.x, p.y),     color, AAValue2 * color.a), p.x, p.y);
+					drawPixel(alphaBlendColor(GetPixel(p.x, p.y + 1), color, AAValue1 * color.a), p.x, p.y + 1);
+					drawPixel(alphaBlendColor(GetPixel(p.x, p.y),     color, AAValue2 * color.a), p.x, p.y);
 				}
 			}
 			
@@ -1914,6 +2368,7 @@ void cdr::Renderer::DrawLine(const cdr::RGBA& color, const Point& start, const P
 }
 
 void cdr::Renderer::DrawRectangle(const RGBA& color, Rectangle rectangle) {
+	addDamage(rectangle.x, rectangle.y, rectangle.width, rectangle.height);
 	// exit if the rectangle is outside of the screen
 	if(rectangle.x >= this->width) return;
 	if(rectangle.y >= this->height) return;
@@ -1943,28 +2398,29 @@ void cdr::Renderer::DrawRectangle(const RGBA& color, Rectangle rectangle) {
 	for(int i = clampedLocation.x + 1; i < clampedLocation.x + clampedWidth; i++) {
 		// top side
 		if(rectangle.y >= 0)
-			DrawPixel(color, i, clampedLocation.y);
+			drawPixel(color, i, clampedLocation.y);
 		// bottom side
 		if(clampedLocation.y + rectangle.height - 1 < this->height)
-			DrawPixel(color, i, clampedLocation.y + rectangle.height - 1);
+			drawPixel(color, i, clampedLocation.y + rectangle.height - 1);
 	}
 	// loop till the itrating value hits the rectangle end or if it goes outside of the screen
 	for(int i = clampedLocation.y; i < clampedLocation.y + clampedHeight; i++) {
 		// left side
 		if(rectangle.x >= 0)
-			DrawPixel(color, clampedLocation.x, i);
+			drawPixel(color, clampedLocation.x, i);
 		// right side
 		if(clampedLocation.x + rectangle.width - 1< this->width)
-			DrawPixel(color, clampedLocation.x + rectangle.width - 1, i);
+			drawPixel(color, clampedLocation.x + rectangle.width - 1, i);
 	}
 }
 void cdr::Renderer::FillRectangle(const RGBA& color, Rectangle rectangle) {
+	addDamage(rectangle.x, rectangle.y, rectangle.width, rectangle.height);
 	// exit if the rectangle is outside of the screen
 	if(rectangle.x >= this->width) return;
 	if(rectangle.y >= this->height) return;
 	
 	if(rectangle.width == 1 && rectangle.height == 1) { 
-		DrawPixel(color, rectangle.x, rectangle.y);
+		drawPixel(color, rectangle.x, rectangle.y);
 		return;
 	}
 	
@@ -1999,6 +2455,7 @@ void cdr::Renderer::FillRectangle(const RGBA& color, Rectangle rectangle) {
 	}
 }
 void cdr::Renderer::FillRectangle(RGBA (*shader)(const Renderer& renderer, int x, int y), Rectangle rectangle) {
+	addDamage(rectangle.x, rectangle.y, rectangle.width, rectangle.height);
 	// exit if the rectangle is outside of the screen
 	if(rectangle.x >= this->width) return;
 	if(rectangle.y >= this->height) return;
@@ -2036,8 +2493,9 @@ void cdr::Renderer::FillRectangle(RGBA (*shader)(const Renderer& renderer, int x
 }
 
 void cdr::Renderer::DrawCircle(const RGBA& color, const Point& centreLocation, int radius, bool AA) {
+	addDamage(centreLocation.x - radius - 1, centreLocation.y - radius - 1, radius * 2 + 3, radius * 2 + 3);
 	if(radius < 1) return;
-	if(radius == 1) DrawPixel(color, centreLocation);
+	if(radius == 1) drawPixel(color, centreLocation);
 	
 	float x{static_cast<float>(radius)};
 	float y{};
@@ -2046,49 +2504,51 @@ void cdr::Renderer::DrawCircle(const RGBA& color, const Point& centreLocation, i
 		x = sqrt(x * x - 2 * y - 1);
 		
 		if(!AA) {
-			DrawPixel(color, (int) x + centreLocation.x, (int) y + centreLocation.y);	
-			DrawPixel(color, (int)-x + centreLocation.x, (int) y + centreLocation.y);
-			DrawPixel(color, (int) x + centreLocation.x, (int)-y + centreLocation.y);
-			DrawPixel(color, (int)-x + centreLocation.x, (int)-y + centreLocation.y);
-			DrawPixel(color, (int) y + centreLocation.x, (int) x + centreLocation.y);
-			DrawPixel(color, (int)-y + centreLocation.x, (int) x + centreLocation.y);
-			DrawPixel(color, (int) y + centreLocation.x, (int)-x + centreLocation.y);
-			DrawPixel(color, (int)-y + centreLocation.x, (int)-x + centreLocation.y);
+			drawPixel(color, (int) x + centreLocation.x, (int) y + centreLocation.y);	
+			drawPixel(color, (int)-x + centreLocation.x, (int) y + centreLocation.y);
+			drawPixel(color, (int) x + centreLocation.x, (int)-y + centreLocation.y);
+			drawPixel(color, (int)-x + centreLocation.x, (int)-y + centreLocation.y);
+			drawPixel(color, (int) y + centreLocation.x, (int) x + centreLocation.y);
+			drawPixel(color, (int)-y + centreLocation.x, (int) x + centreLocation.y);
+			drawPixel(color, (int) y + centreLocation.x, (int)-x + centreLocation.y);
+			drawPixel(color, (int)-y + centreLocation.x, (int)-x + centreLocation.y);
 		}
 		else {
 			float AAValue1 = 255 * (x - static_cast<int>(x));
 			float AAValue2 = 255 * (1 - (x - static_cast<int>(x)));
 			
-			DrawPixel(alphaBlendColor(GetPixel((int) x + centreLocation.x, (int) y + centreLocation.y), color, AAValue1), (int)x + centreLocation.x, (int)y + centreLocation.y);
-			DrawPixel(alphaBlendColor(GetPixel((int) x + centreLocation.x - 1, (int) y + centreLocation.y), color, AAValue2), (int) x + centreLocation.x - 1, (int) y + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int) x + centreLocation.x, (int) y + centreLocation.y), color, AAValue1), (int)x + centreLocation.x, (int)y + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int) x + centreLocation.x - 1, (int) y + centreLocation.y), color, AAValue2), (int) x + centreLocation.x - 1, (int) y + centreLocation.y);
 			
-			DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int) y + centreLocation.y), color, AAValue1), (int)-x + centreLocation.x, (int) y + centreLocation.y);
-			DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int) y + centreLocation.y), color, AAValue2), (int)-x + centreLocation.x + 1, (int) y + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int) y + centreLocation.y), color, AAValue1), (int)-x + centreLocation.x, (int) y + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int) y + centreLocation.y), color, AAValue2), (int)-x + centreLocation.x + 1, (int) y + centreLocation.y);
 			
-			DrawPixel(alphaBlendColor(GetPixel((int) x + centreLocation.x, (int)-y + centreLocation.y), color, AAValue1), (int) x + centreLocation.x, (int)-y + centreLocation.y);
-			DrawPixel(alphaBlendColor(GetPixel((int) x + centreLocation.x - 1, (int)-y + centreLocation.y), color, AAValue2), (int) x + centreLocation.x - 1, (int)-y + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int) x + centreLocation.x, (int)-y + centreLocation.y), color, AAValue1), (int) x + centreLocation.x, (int)-y + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int) x + centreLocation.x - 1, (int)-y + centreLocation.y), color, AAValue2), (int) x + centreLocation.x - 1, (int)-y + centreLocation.y);
 			
-			DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int)-y + centreLocation.y), color, AAValue1), (int)-x + centreLocation.x, (int)-y + centreLocation.y);
-			DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int)-y + centreLocation.y), color, AAValue2), (int)-x + centreLocation.x + 1, (int)-y + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int)-y + centreLocation.y), color, AAValue1), (int)-x + centreLocation.x, (int)-y + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int)-y + centreLocation.y), color, AAValue2), (int)-x + centreLocation.x + 1, (int)-y + centreLocation.y);
 			
-			DrawPixel(alphaBlendColor(GetPixel((int) y + centreLocation.x, (int) x + centreLocation.y), color, AAValue1), (int) y + centreLocation.x, (int) x + centreLocation.y);
-			DrawPixel(alphaBlendColor(GetPixel((int) y + centreLocation.x, (int) x + centreLocation.y - 1), color, AAValue2), (int) y + centreLocation.x, (int) x + centreLocation.y - 1);
+			drawPixel(alphaBlendColor(GetPixel((int) y + centreLocation.x, (int) x + centreLocation.y), color, AAValue1), (int) y + centreLocation.x, (int) x + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int) y + centreLocation.x, (int) x + centreLocation.y - 1), color, AAValue2), (int) y + centreLocation.x, (int) x + centreLocation.y - 1);
 			
-			DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int) x + centreLocation.y), color, AAValue1), (int)-y + centreLocation.x, (int) x + centreLocation.y);
-			DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int) x + centreLocation.y - 1), color, AAValue2), (int)-y + centreLocation.x, (int) x + centreLocation.y - 1);
+			drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int) x + centreLocation.y), color, AAValue1), (int)-y + centreLocation.x, (int) x + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int) x + centreLocation.y - 1), color, AAValue2), (int)-y + centreLocation.x, (int) x + centreLocation.y - 1);
 			
-			DrawPixel(alphaBlendColor(GetPixel((int) y + centreLocation.x, (int)-x + centreLocation.y), color, AAValue1), (int) y + centreLocation.x, (int)-x + centreLocation.y);
-			DrawPixel(alphaBlendColor(GetPixel((int) y + centreLocation.x, (int)-x + centreLocation.y + 1), color, AAValue2), (int) y + centreLocation.x, (int)-x + centreLocation.y + 1);
+			drawPixel(alphaBlendColor(GetPixel((int) y + centreLocation.x, (int)-x + centreLocation.y), color, AAValue1), (int) y + centreLocation.x, (int)-x + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int) y + centreLocation.x, (int)-x + centreLocation.y + 1), color, AAValue2), (int) y + centreLocation.x, (int)-x + centreLocation.y + 1);
 			
-			DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y), color, AAValue1), (int)-y + centreLocation.x, (int)-x + centreLocation.y);
-			DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y + 1), color, AAValue2), (int)-y + centreLocation.x, (int)-x + centreLocation.y + 1);
+			drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y), color, AAValue1), (int)-y + centreLocation.x, (int)-x + centreLocation.y);
+			drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y + 1), color, AAValue2), (int)-y + centreLocation.x, (int)-x + centreLocation.y + 1);
 		}
 		y++;
 	}
 }
 void cdr::Renderer::FillCircle(const RGBA& color, const Point& centreLocation, int radius, bool AA) {
+	CIDR_PROFILE_ZONE("Renderer::FillCircle");
+	addDamage(centreLocation.x - radius - 1, centreLocation.y - radius - 1, radius * 2 + 3, radius * 2 + 3);
 	if(radius < 1) return;
-	if(radius == 1) DrawPixel(color, centreLocation);
+	if(radius == 1) drawPixel(color, centreLocation);
 	
 	float x{static_cast<float>(radius)};
 	float y{};
@@ -2098,36 +2558,36 @@ void cdr::Renderer::FillCircle(const RGBA& color, const Point& centreLocation, i
 		
 		for(int i = (int)-x + centreLocation.x; i < (int)x + centreLocation.x; i++) {
 			if(!AA || (i != (int)-x + centreLocation.x)){
-				DrawPixel(color, i, (int)y + centreLocation.y);
-				DrawPixel(color, i, (int)-y + centreLocation.y);
+				drawPixel(color, i, (int)y + centreLocation.y);
+				drawPixel(color, i, (int)-y + centreLocation.y);
 			}
 			else {
 				float AAValue1 = 255 * (x - static_cast<int>(x));
 				float AAValue2 = 255 * (1 - (x - static_cast<int>(x)));
 				
-				DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int)y + centreLocation.y), color, AAValue1), (int)-x + centreLocation.x, (int)y + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int)y + centreLocation.y), color, AAValue2), (int)-x + centreLocation.x + 1, (int)y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int)y + centreLocation.y), color, AAValue1), (int)-x + centreLocation.x, (int)y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int)y + centreLocation.y), color, AAValue2), (int)-x + centreLocation.x + 1, (int)y + centreLocation.y);
 				
-				DrawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x, (int)y + centreLocation.y), color, AAValue1), (int)x + centreLocation.x, (int)y + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x - 1, (int)y + centreLocation.y), color, AAValue2), (int)x + centreLocation.x - 1, (int)y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x, (int)y + centreLocation.y), color, AAValue1), (int)x + centreLocation.x, (int)y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x - 1, (int)y + centreLocation.y), color, AAValue2), (int)x + centreLocation.x - 1, (int)y + centreLocation.y);
 				
-				DrawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x, (int)-y + centreLocation.y), color, AAValue1), (int)x + centreLocation.x, (int)-y + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x - 1, (int)-y + centreLocation.y), color, AAValue2), (int)x + centreLocation.x - 1, (int)-y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x, (int)-y + centreLocation.y), color, AAValue1), (int)x + centreLocation.x, (int)-y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x - 1, (int)-y + centreLocation.y), color, AAValue2), (int)x + centreLocation.x - 1, (int)-y + centreLocation.y);
 
-				DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int)-y + centreLocation.y), color, AAValue1), (int)-x + centreLocation.x, (int)-y + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int)-y + centreLocation.y), color, AAValue2), (int)-x + centreLocation.x + 1, (int)-y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int)-y + centreLocation.y), color, AAValue1), (int)-x + centreLocation.x, (int)-y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int)-y + centreLocation.y), color, AAValue2), (int)-x + centreLocation.x + 1, (int)-y + centreLocation.y);
 				
-				DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)x + centreLocation.y), color, AAValue1), (int)-y + centreLocation.x, (int)x + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)x + centreLocation.y - 1), color, AAValue2), (int)-y + centreLocation.x, (int)x + centreLocation.y - 1);
+				drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)x + centreLocation.y), color, AAValue1), (int)-y + centreLocation.x, (int)x + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)x + centreLocation.y - 1), color, AAValue2), (int)-y + centreLocation.x, (int)x + centreLocation.y - 1);
 				
-				DrawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)x + centreLocation.y), color, AAValue1), (int)y + centreLocation.x, (int)x + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)x + centreLocation.y - 1), color, AAValue2), (int)y + centreLocation.x, (int)x + centreLocation.y - 1);
+				drawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)x + centreLocation.y), color, AAValue1), (int)y + centreLocation.x, (int)x + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)x + centreLocation.y - 1), color, AAValue2), (int)y + centreLocation.x, (int)x + centreLocation.y - 1);
 
-				DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y), color, AAValue1), (int)-y + centreLocation.x, (int)-x + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y + 1), color, AAValue2), (int)-y + centreLocation.x, (int)-x + centreLocation.y + 1);
+				drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y), color, AAValue1), (int)-y + centreLocation.x, (int)-x + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y + 1), color, AAValue2), (int)-y + centreLocation.x, (int)-x + centreLocation.y + 1);
 								
-				DrawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)-x + centreLocation.y), color, AAValue1), (int)y + centreLocation.x, (int)-x + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)-x + centreLocation.y + 1), color, AAValue2), (int)y + centreLocation.x, (int)-x + centreLocation.y + 1);
+				drawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)-x + centreLocation.y), color, AAValue1), (int)y + centreLocation.x, (int)-x + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)-x + centreLocation.y + 1), color, AAValue2), (int)y + centreLocation.x, (int)-x + centreLocation.y + 1);
 			}
 		}
 		
@@ -2135,8 +2595,10 @@ void cdr::Renderer::FillCircle(const RGBA& color, const Point& centreLocation, i
 	}
 }
 void cdr::Renderer::FillCircle(RGBA (*shader)(const Renderer& renderer, int x, int y), const Point& centreLocation, int radius, bool AA) {
+	CIDR_PROFILE_ZONE("Renderer::FillCircle");
+	addDamage(centreLocation.x - radius - 1, centreLocation.y - radius - 1, radius * 2 + 3, radius * 2 + 3);
 	if(radius < 1) return;
-	if(radius == 1) DrawPixel(shader(*this, centreLocation.x, centreLocation.y), centreLocation);
+	if(radius == 1) drawPixel(shader(*this, centreLocation.x, centreLocation.y), centreLocation);
 	
 	float x{static_cast<float>(radius)};
 	float y{};
@@ -2160,36 +2622,36 @@ void cdr::Renderer::FillCircle(RGBA (*shader)(const Renderer& renderer, int x, i
 		for(int i = (int)-x + centreLocation.x; i < (int)x + centreLocation.x; i++) {
 			if(!AA || (i != (int)-x + centreLocation.x)) {
 				int ni = i - centreLocation.x + radius;
-				DrawPixel(shadedPixels[ni][y + radius], i, (int)y + centreLocation.y);
-				DrawPixel(shadedPixels[ni][-y + radius], i, (int)-y + centreLocation.y);
+				drawPixel(shadedPixels[ni][y + radius], i, (int)y + centreLocation.y);
+				drawPixel(shadedPixels[ni][-y + radius], i, (int)-y + centreLocation.y);
 			}
 			else  {
 				float AAValue1 = 255 * (x - static_cast<int>(x));
 				float AAValue2 = 255 * (1 - (x - static_cast<int>(x)));
 				
-				DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int)y + centreLocation.y), shadedPixels[(int)-x + radius][y + radius], AAValue1), (int)-x + centreLocation.x, (int)y + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int)y + centreLocation.y), shadedPixels[(int)-x + 1 + radius][y + radius], AAValue2), (int)-x + centreLocation.x + 1, (int)y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int)y + centreLocation.y), shadedPixels[(int)-x + radius][y + radius], AAValue1), (int)-x + centreLocation.x, (int)y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int)y + centreLocation.y), shadedPixels[(int)-x + 1 + radius][y + radius], AAValue2), (int)-x + centreLocation.x + 1, (int)y + centreLocation.y);
 				
-				DrawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x, (int)y + centreLocation.y), shadedPixels[(int)x + radius][y + radius], AAValue1), (int)x + centreLocation.x, (int)y + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x - 1, (int)y + centreLocation.y), shadedPixels[(int)x - 1 + radius][y + radius], AAValue2), (int)x + centreLocation.x - 1, (int)y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x, (int)y + centreLocation.y), shadedPixels[(int)x + radius][y + radius], AAValue1), (int)x + centreLocation.x, (int)y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x - 1, (int)y + centreLocation.y), shadedPixels[(int)x - 1 + radius][y + radius], AAValue2), (int)x + centreLocation.x - 1, (int)y + centreLocation.y);
 				
-				DrawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x, (int)-y + centreLocation.y), shadedPixels[(int)x + radius][-y + radius], AAValue1), (int)x + centreLocation.x, (int)-y + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x - 1, (int)-y + centreLocation.y), shadedPixels[(int)x - 1 + radius][-y + radius], AAValue2), (int)x + centreLocation.x - 1, (int)-y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x, (int)-y + centreLocation.y), shadedPixels[(int)x + radius][-y + radius], AAValue1), (int)x + centreLocation.x, (int)-y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)x + centreLocation.x - 1, (int)-y + centreLocation.y), shadedPixels[(int)x - 1 + radius][-y + radius], AAValue2), (int)x + centreLocation.x - 1, (int)-y + centreLocation.y);
 
-				DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int)-y + centreLocation.y), shadedPixels[(int)-x + radius][-y + radius], AAValue1), (int)-x + centreLocation.x, (int)-y + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int)-y + centreLocation.y), shadedPixels[(int)-x + 1 + radius][-y + radius], AAValue2), (int)-x + centreLocation.x + 1, (int)-y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x, (int)-y + centreLocation.y), shadedPixels[(int)-x + radius][-y + radius], AAValue1), (int)-x + centreLocation.x, (int)-y + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-x + centreLocation.x + 1, (int)-y + centreLocation.y), shadedPixels[(int)-x + 1 + radius][-y + radius], AAValue2), (int)-x + centreLocation.x + 1, (int)-y + centreLocation.y);
 				
-				DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)x + centreLocation.y), shadedPixels[-y + radius][(int)x + radius], AAValue1), (int)-y + centreLocation.x, (int)x + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)x + centreLocation.y - 1), shadedPixels[-y + radius][(int)x + radius - 1], AAValue2), (int)-y + centreLocation.x, (int)x + centreLocation.y - 1);
+				drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)x + centreLocation.y), shadedPixels[-y + radius][(int)x + radius], AAValue1), (int)-y + centreLocation.x, (int)x + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)x + centreLocation.y - 1), shadedPixels[-y + radius][(int)x + radius - 1], AAValue2), (int)-y + centreLocation.x, (int)x + centreLocation.y - 1);
 				
-				DrawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)x + centreLocation.y), shadedPixels[y + radius][(int)x + radius], AAValue1), (int)y + centreLocation.x, (int)x + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)x + centreLocation.y - 1), shadedPixels[y + radius][(int)x + radius - 1], AAValue2), (int)y + centreLocation.x, (int)x + centreLocation.y - 1);
+				drawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)x + centreLocation.y), shadedPixels[y + radius][(int)x + radius], AAValue1), (int)y + centreLocation.x, (int)x + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)x + centreLocation.y - 1), shadedPixels[y + radius][(int)x + radius - 1], AAValue2), (int)y + centreLocation.x, (int)x + centreLocation.y - 1);
 
-				DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y), shadedPixels[-y + radius][(int)-x + radius], AAValue1), (int)-y + centreLocation.x, (int)-x + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y + 1), shadedPixels[-y + radius][(int)-x + radius + 1], AAValue2), (int)-y + centreLocation.x, (int)-x + centreLocation.y + 1);
+				drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y), shadedPixels[-y + radius][(int)-x + radius], AAValue1), (int)-y + centreLocation.x, (int)-x + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)-y + centreLocation.x, (int)-x + centreLocation.y + 1), shadedPixels[-y + radius][(int)-x + radius + 1], AAValue2), (int)-y + centreLocation.x, (int)-x + centreLocation.y + 1);
 								
-				DrawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)-x + centreLocation.y), shadedPixels[y + radius][(int)-x + radius], AAValue1), (int)y + centreLocation.x, (int)-x + centreLocation.y);
-				DrawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)-x + centreLocation.y + 1), shadedPixels[y + radius][(int)-x + radius + 1], AAValue2), (int)y + centreLocation.x, (int)-x + centreLocation.y + 1);
+				drawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)-x + centreLocation.y), shadedPixels[y + radius][(int)-x + radius], AAValue1), (int)y + centreLocation.x, (int)-x + centreLocation.y);
+				drawPixel(alphaBlendColor(GetPixel((int)y + centreLocation.x, (int)-x + centreLocation.y + 1), shadedPixels[y + radius][(int)-x + radius + 1], AAValue2), (int)y + centreLocation.x, (int)-x + centreLocation.y + 1);
 			}
 		}
 		
@@ -2207,8 +2669,39 @@ struct DPoint {
 	double y;
 } minTx, maxTx;
 
-// void cdr::Renderer::DrawTriangle(const Bitmap& texture, float tx1, float ty1, float tx2, float ty2, float tx3, float ty3, float x1, float y1, float x2, float y2, float x3, float y3) {
-void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2, FPoint tp3, FPoint p1, FPoint p2, FPoint p3) {
+// void cdr::Renderer::DrawTriangle(const BitmapView& texture, float tx1, float ty1, float tx2, float ty2, float tx3, float ty3, float x1, float y1, float x2, float y2, float x3, float y3) {
+void cdr::Renderer::DrawTriangle(const BitmapView& texture, FPoint tp1, FPoint tp2, FPoint tp3, FPoint p1, FPoint p2, FPoint p3) {
+	CIDR_PROFILE_ZONE("Renderer::DrawTriangle");
+	// minified textures are read from their mips, an affine mapping has the same scale everywhere
+	float lod = 0;
+	if (texture.GetMipCount() > 1) {
+		float texelArea = std::abs((tp2.x - tp1.x) * (tp3.y - tp1.y) - (tp3.x - tp1.x) * (tp2.y - tp1.y)) * texture.GetWidth() * texture.GetHeight();
+		float pixelArea = std::abs((p2.x - p1.x) * (p3.y - p1.y) - (p3.x - p1.x) * (p2.y - p1.y));
+		if (pixelArea > 0 && texelArea > pixelArea) lod = 0.5f * std::log2(texelArea / pixelArea);
+		// nearest sampling just draws from the closest level
+		int level = std::min((int)(lod + 0.5f), texture.GetMipCount() - 1);
+		if (this->ScaleType == ScaleType::Nearest && level > 0) {
+			DrawTriangle(texture.GetMip(level), tp1, tp2, tp3, p1, p2, p3);
+			return;
+		}
+	}
+	// Rotated mappings walk across the rows of the texture, the tiled copy keeps those reads in a few
+	// cache lines if the texture has one. Slightly rotated ones stay in a row long enough, small
+	// textures stay in the cache.
+	if (!texture.IsTiled() && texture.GetWidth() * texture.GetHeight() > 64 * 64) {
+		float area = (p2.x - p1.x) * (p3.y - p1.y) - (p3.x - p1.x) * (p2.y - p1.y);
+		// texture rows per pixel along a scan line
+		float rowsPerPixel = area != 0 ? ((tp2.y - tp1.y) * (p3.y - p1.y) - (tp3.y - tp1.y) * (p2.y - p1.y)) / area * texture.GetHeight() : 0;
+		if (std::abs(rowsPerPixel) >= 0.5f) {
+			BitmapView tiled = texture.Tiled();
+			if (tiled.IsTiled()) {
+				DrawTriangle(tiled, tp1, tp2, tp3, p1, p2, p3);
+				return;
+			}
+		}
+	}
+	addDamage(std::min({p1.x, p2.x, p3.x}) - 1, std::min({p1.y, p2.y, p3.y}) - 1,
+		std::max({p1.x, p2.x, p3.x}) - std::min({p1.x, p2.x, p3.x}) + 3, std::max({p1.y, p2.y, p3.y}) - std::min({p1.y, p2.y, p3.y}) + 3);
 	// Timer t{};
 	
 	// sort top most point
@@ -2235,7 +2728,8 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 
 
 #if !defined(CDR_LINEAR) && !defined(CDR_BARYCENTRIC)
-	for (int y = std::ceil(p1.y); y < std::ceil(p2.y); y++) {
+	// NOTE: clipped to the target, rotated bitmaps easily stick out of it
+	for (int y = std::max((int)std::ceil(p1.y), 0); y < std::min((int)std::ceil(p2.y), height); y++) {
 		double t1 = (y - std::ceil(p1.y)) / (double)(std::ceil(p3.y) - std::ceil(p1.y));
 		double t2 = (y - std::ceil(p1.y)) / (double)(std::ceil(p2.y) - std::ceil(p1.y));
 
@@ -2267,6 +2761,12 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 		xLerp -= (min - startX) * xStep;
 		double yLerp = minTx.y;
 		yLerp -= (min - startX) * yStep;
+		if (startX < 0) {
+			xLerp -= startX * xStep;
+			yLerp -= startX * yStep;
+			startX = 0;
+		}
+		endX = std::min(endX, width);
 		
 		for (int x = startX; x < endX; x++) {
 #ifdef CDR_PERFORMANCE
@@ -2274,13 +2774,18 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 #else
 			// NOTE: doing this, instead of just DrawPixel(sampleTexture(texture, xLerp, yLerp), x, y), in order to achieve *performance*
 			if (this->ScaleType == ScaleType::Nearest) {
-				if (!useAlphaBlending && (texture.GetRawPixel((float)xLerp, (float)yLerp)& 0xff) != 0 && (float)xLerp >= 0 && (float)yLerp >= 0 && (float)xLerp < texture.GetWidth() && (float)yLerp < texture.GetHeight()) {
-					pixels[getIndex(x, y)] = texture.GetRawPixel((float)xLerp, (float)yLerp);
+				// NOTE: checks the bounds first, there's nothing to read outside of a tiled texture
+				uint32_t texel = 0;
+				if (!useAlphaBlending && (float)xLerp >= 0 && (float)yLerp >= 0 && (float)xLerp < texture.GetWidth() && (float)yLerp < texture.GetHeight()) {
+					texel = texture.GetRawPixel((float)xLerp, (float)yLerp);
+				}
+				if ((texel & 0xff) != 0) {
+					pixels[getIndex(x, y)] = texel;
 				} else {
-					DrawPixel(sampleTextureRaw(texture, (float)xLerp, (float)yLerp), x, y);
+					drawPixel(sampleTextureRaw(texture, (float)xLerp, (float)yLerp), x, y);
 				}
 			} else {
-				DrawPixel(sampleTexture(texture, xLerp, yLerp), x, y);
+				drawPixel(lod > 0 ? sampleTextureLod(texture, xLerp, yLerp, lod) : sampleTexture(texture, xLerp, yLerp), x, y);
 			}
 #endif
 			
@@ -2289,7 +2794,7 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 		}
 	}
 	
-	for (int y = std::ceil(p2.y); y < std::ceil(p3.y); y++) {
+	for (int y = std::max((int)std::ceil(p2.y), 0); y < std::min((int)std::ceil(p3.y), height); y++) {
 		double t1 = (y - std::ceil(p1.y)) / (double)(std::ceil(p3.y) - std::ceil(p1.y));
 		double t2 = (y - std::ceil(p2.y)) / (double)(std::ceil(p3.y) - std::ceil(p2.y));
 		
@@ -2321,6 +2826,12 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 		xLerp -= (min - startX) * xStep;
 		double yLerp = minTx.y;
 		yLerp -= (min - startX) * yStep;
+		if (startX < 0) {
+			xLerp -= startX * xStep;
+			yLerp -= startX * yStep;
+			startX = 0;
+		}
+		endX = std::min(endX, width);
 		
 		for (int x = startX; x < endX; x++) {
 #ifdef CDR_PERFORMANCE
@@ -2328,13 +2839,18 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 #else
 			// NOTE: doing this, instead of just DrawPixel(sampleTexture(texture, xLerp, yLerp), x, y), in order to achieve *performance*
 			if (this->ScaleType == ScaleType::Nearest) {
-				if (!useAlphaBlending && (texture.GetRawPixel((float)xLerp, (float)yLerp)& 0xff) != 0 && (float)xLerp >= 0 && (float)yLerp >= 0 && (float)xLerp < texture.GetWidth() && (float)yLerp < texture.GetHeight()) {
-					pixels[getIndex(x, y)] = texture.GetRawPixel((float)xLerp, (float)yLerp);
+				// NOTE: checks the bounds first, there's nothing to read outside of a tiled texture
+				uint32_t texel = 0;
+				if (!useAlphaBlending && (float)xLerp >= 0 && (float)yLerp >= 0 && (float)xLerp < texture.GetWidth() && (float)yLerp < texture.GetHeight()) {
+					texel = texture.GetRawPixel((float)xLerp, (float)yLerp);
+				}
+				if ((texel & 0xff) != 0) {
+					pixels[getIndex(x, y)] = texel;
 				} else {
-					DrawPixel(sampleTextureRaw(texture, (float)xLerp, (float)yLerp), x, y);
+					drawPixel(sampleTextureRaw(texture, (float)xLerp, (float)yLerp), x, y);
 				}
 			} else {
-				DrawPixel(sampleTexture(texture, xLerp, yLerp), x, y);
+				drawPixel(lod > 0 ? sampleTextureLod(texture, xLerp, yLerp, lod) : sampleTexture(texture, xLerp, yLerp), x, y);
 			}
 #endif
 			
@@ -2370,9 +2886,9 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 		}
 		
 		for (int x = startX; x < endX; x++) {
-			DrawPixel(sampleTexture(texture, 
+			drawPixel(sampleTextureLod(texture, 
 				lerp(minTx.x, maxTx.x, (x - min) / (max - min)), 
-				lerp(minTx.y, maxTx.y, (x - min) / (max - min))), 
+				lerp(minTx.y, maxTx.y, (x - min) / (max - min)), lod), 
 				x, y);
 		}
 	}
@@ -2402,9 +2918,9 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 		}
 		
 		for (int x = startX; x < endX; x++) {
-			DrawPixel(sampleTexture(texture, 
+			drawPixel(sampleTextureLod(texture, 
 				lerp(minTx.x, maxTx.x, (x - min) / (max - min)), 
-				lerp(minTx.y, maxTx.y, (x - min) / (max - min))), 
+				lerp(minTx.y, maxTx.y, (x - min) / (max - min)), lod), 
 				x, y);
 		}
 	}
@@ -2453,8 +2969,8 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 			float t = (w1 * tp1.x + w2 * tp2.x + w3 * tp3.x);
 			float s = (w1 * tp1.y + w2 * tp2.y + w3 * tp3.y);
 			
-			DrawPixel(sampleTexture(texture, 
-				t, s),
+			drawPixel(sampleTextureLod(texture, 
+				t, s, lod),
 				x, y);
 		}
 		
@@ -2492,7 +3008,7 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 			float t = (w1 * tp1.x + w2 * tp2.x + w3 * tp3.x);
 			float s = (w1 * tp1.y + w2 * tp2.y + w3 * tp3.y);
 			
-			DrawPixel(sampleTexture(texture, 
+			drawPixel(sampleTexture(texture, 
 				t, 
 				s),
 				x, y);
@@ -2515,6 +3031,9 @@ void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2,
 	// }
 }
 void cdr::Renderer::FillTriangle(const RGBA& color, Point p1, Point p2, Point p3) {
+	CIDR_PROFILE_ZONE("Renderer::FillTriangle");
+	addDamage(std::min({p1.x, p2.x, p3.x}) - 1, std::min({p1.y, p2.y, p3.y}) - 1,
+		std::max({p1.x, p2.x, p3.x}) - std::min({p1.x, p2.x, p3.x}) + 3, std::max({p1.y, p2.y, p3.y}) - std::min({p1.y, p2.y, p3.y}) + 3);
 	// sort top most point
 	if(p1.y > p2.y) {
 		std::swap(p1, p2);
@@ -2549,6 +3068,9 @@ void cdr::Renderer::FillTriangle(const RGBA& color, Point p1, Point p2, Point p3
 	}
 }
 void cdr::Renderer::FillTriangle(RGBA color1, RGBA color2, RGBA color3, Point p1, Point p2, Point p3) {
+	CIDR_PROFILE_ZONE("Renderer::FillTriangle");
+	addDamage(std::min({p1.x, p2.x, p3.x}) - 1, std::min({p1.y, p2.y, p3.y}) - 1,
+		std::max({p1.x, p2.x, p3.x}) - std::min({p1.x, p2.x, p3.x}) + 3, std::max({p1.y, p2.y, p3.y}) - std::min({p1.y, p2.y, p3.y}) + 3);
 	// sort top most point
 	if(p1.y > p2.y) {
 		std::swap(p1, p2);
@@ -2615,6 +3137,9 @@ void cdr::Renderer::FillTriangle(RGBA color1, RGBA color2, RGBA color3, Point p1
 	}
 }
 void cdr::Renderer::FillTriangle(RGBA (*shader)(const Renderer& renderer, int x, int y), Point p1, Point p2, Point p3) {
+	CIDR_PROFILE_ZONE("Renderer::FillTriangle");
+	addDamage(std::min({p1.x, p2.x, p3.x}) - 1, std::min({p1.y, p2.y, p3.y}) - 1,
+		std::max({p1.x, p2.x, p3.x}) - std::min({p1.x, p2.x, p3.x}) + 3, std::max({p1.y, p2.y, p3.y}) - std::min({p1.y, p2.y, p3.y}) + 3);
 	// sort top most point
 	if(p1.y > p2.y) {
 		std::swap(p1, p2);
@@ -2691,7 +3216,7 @@ void cdr::Renderer::drawScanLine(uint32_t color, int startX, int endX, int y) {
 	// std::fill_n(pixels + getIndex(startX, y), endX - startX, color);
 	for(int i = startX; i <= endX; i++) {
 		// if(GetPixel(i,y).r)
-		DrawPixel(color, i, y);
+		drawPixel(color, i, y);
 	}
 }
 void cdr::Renderer::drawScanLine(const RGBA& color1, const RGBA& color2, int startX, int endX, int y) {
@@ -2706,7 +3231,7 @@ void cdr::Renderer::drawScanLine(const RGBA& color1, const RGBA& color2, int sta
 	float aLerp{static_cast<float>(color1.a)};
 	
 	for (int i = startX; i < endX; i++) {
-		DrawPixel({(uint8_t)rLerp, (uint8_t)gLerp, (uint8_t)bLerp, (uint8_t)aLerp}, i, y);
+		drawPixel({(uint8_t)rLerp, (uint8_t)gLerp, (uint8_t)bLerp, (uint8_t)aLerp}, i, y);
 		
 		rLerp += rStep;
 		gLerp += gStep;
@@ -2715,7 +3240,9 @@ void cdr::Renderer::drawScanLine(const RGBA& color1, const RGBA& color2, int sta
 	}
 }
 // TODO: fix this mess
-void cdr::Renderer::DrawBitmap(const Bitmap& bitmap, float destX, float destY, int destWidth, int destHeight, float srcX, float srcY, int srcWidth, int srcHeight) {
+void cdr::Renderer::DrawBitmap(const BitmapView& bitmap, float destX, float destY, int destWidth, int destHeight, float srcX, float srcY, int srcWidth, int srcHeight) {
+	CIDR_PROFILE_ZONE("Renderer::DrawBitmap");
+	addDamage(std::floor(destX), std::floor(destY), destWidth + 1, destHeight + 1);
 	// Exit if image is out of bounds of the canvas
 	if(destX >= width) return;	
 	if(destY >= height) return;
@@ -2749,15 +3276,26 @@ void cdr::Renderer::DrawBitmap(const Bitmap& bitmap, float destX, float destY, i
 		
 		for(int i = srcY; i < srcY + bitmap.GetHeight() - (bitmap.GetHeight() - destHeight); i++) {			
 			memcpy(pixels + getIndex(destX, destY + (i - srcY)), 
-				bitmap.GetData() + i * bitmap.GetWidth() + (int)srcX, 
+				bitmap.GetData() + i * bitmap.GetPitch() + (int)srcX, 
 				(bitmap.GetWidth() - (bitmap.GetWidth() - srcWidth)) * sizeof(uint32_t)); 
 		}
 	} else {
 		float cx = destWidth / (float)srcWidth;
 		float cy = destHeight / (float)srcHeight;
+		// minified bitmaps are read from their mips, so neighbouring pixels read neighbouring texels
+		BitmapView level = bitmap;
+		BitmapView next;
+		float blend = 0;
+		if (bitmap.GetMipCount() > 1) {
+			selectMips(bitmap, std::log2(std::max(1 / cx, 1 / cy)), level, next, blend);
+		}
+		float levelX = level.GetWidth() / (float)bitmap.GetWidth();
+		float levelY = level.GetHeight() / (float)bitmap.GetHeight();
+		float nextX = next.GetWidth() / (float)bitmap.GetWidth();
+		float nextY = next.GetHeight() / (float)bitmap.GetHeight();
 		
-		for (int iDest = destX; iDest < destX + destWidth; iDest++) {
-			for (int jDest = destY; jDest < destY + destHeight; jDest++) {
+		for (int jDest = destY; jDest < destY + destHeight; jDest++) {
+			for (int iDest = destX; iDest < destX + destWidth; iDest++) {
 				
 				if(iDest < 0 || jDest < 0 || iDest >= GetWidth() || jDest >= GetHeight()) 
 					continue;
@@ -2765,7 +3303,17 @@ void cdr::Renderer::DrawBitmap(const Bitmap& bitmap, float destX, float destY, i
 				float iSrc = (iDest - destX) / (float)cx + srcX;
 				float jSrc = (jDest - destY) / (float)cy + srcY;
 				
-				DrawPixel(sampleTexture(bitmap, iSrc, jSrc), iDest, jDest);
+				RGBA color = sampleTexture(level, iSrc * levelX, jSrc * levelY);
+				if (blend > 0) {
+					RGBA far = sampleTexture(next, iSrc * nextX, jSrc * nextY);
+					color = RGBA(
+						color.r + (far.r - color.r) * blend,
+						color.g + (far.g - color.g) * blend,
+						color.b + (far.b - color.b) * blend,
+						color.a + (far.a - color.a) * blend
+					);
+				}
+				drawPixel(color, iDest, jDest);
 				
 #if 0
 				int fooX = 0;
@@ -2781,7 +3329,7 @@ void cdr::Renderer::DrawBitmap(const Bitmap& bitmap, float destX, float destY, i
 						fooY = (int)((jSrc + 0.001) / bitmap.GetHeight()) % 2 + (jSrc < 0 ? 1 : 0);
 					}
 					else if(OutOfBoundsType == OutOfBoundsType::ClampToBorder) {
-						DrawPixel(ClampToBorderColor, iDest, jDest);
+						drawPixel(ClampToBorderColor, iDest, jDest);
 						continue;
 					}
 				}
@@ -2806,7 +3354,7 @@ void cdr::Renderer::DrawBitmap(const Bitmap& bitmap, float destX, float destY, i
 						iSrc = ceil(iSrc);
 					if(fooY) 
 						jSrc = ceil(jSrc);
-					DrawPixel(bitmap.GetPixel(iSrc, jSrc), iDest, jDest);
+					drawPixel(bitmap.GetPixel(iSrc, jSrc), iDest, jDest);
 				} else { 
 					// TODO: cheßck if downscaling works properly
 					
@@ -2836,14 +3384,77 @@ void cdr::Renderer::DrawBitmap(const Bitmap& bitmap, float destX, float destY, i
 						cB * jSrcFraction 
 					};
 					
-					DrawPixel(c, iDest, jDest);
+					drawPixel(c, iDest, jDest);
 				}
 #endif
 			}
 		}
 	}
 }
-cdr::RGBA cdr::Renderer::sampleTexture(const cdr::Bitmap& bitmap, float xSrc, float ySrc) const {
+void cdr::Renderer::DrawBitmap(const BitmapView& bitmap, float centreX, float centreY, int destWidth, int destHeight, float angle) {
+	float c = std::cos(angle);
+	float s = std::sin(angle);
+	auto corner = [&](float x, float y) {
+		return FPoint{centreX + x * c - y * s, centreY + x * s + y * c};
+	};
+	FPoint topLeft = corner(-destWidth / 2.0f, -destHeight / 2.0f);
+	FPoint topRight = corner(destWidth / 2.0f, -destHeight / 2.0f);
+	FPoint bottomRight = corner(destWidth / 2.0f, destHeight / 2.0f);
+	FPoint bottomLeft = corner(-destWidth / 2.0f, destHeight / 2.0f);
+	// NOTE: the triangles pick the tiled copy of the bitmap themselves when that's worth it
+	DrawTriangle(bitmap, FPoint{0, 0}, FPoint{1, 0}, FPoint{1, 1}, topLeft, topRight, bottomRight);
+	DrawTriangle(bitmap, FPoint{0, 0}, FPoint{1, 1}, FPoint{0, 1}, topLeft, bottomRight, bottomLeft);
+}
+void cdr::Renderer::DrawSprite(const Sprite& sprite, int x, int y) {
+	CIDR_PROFILE_ZONE("Renderer::DrawSprite");
+	if (!sprite.IsValid()) return;
+	int left = std::max(x, 0);
+	int top = std::max(y, 0);
+	int right = std::min(x + sprite.GetWidth(), width);
+	int bottom = std::min(y + sprite.GetHeight(), height);
+	if (left >= right || top >= bottom) return;
+	addDamage(left, top, right - left, bottom - top);
+	
+	BitmapView source = sprite.GetView();
+	int count = right - left;
+	for (int row = top; row < bottom; row++) {
+		const uint32_t* texels = source.GetData() + (size_t)(row - y) * source.GetPitch() + (left - x);
+		uint32_t* destination = pixels + getIndex(left, row);
+		// NOTE: blending an opaque texel gives the texel, a transparent one over an opaque pixel the pixel
+		auto drawTexel = [&](int i) {
+			uint8_t alpha = texels[i] & 0xff;
+			if (alpha == 0xff || (!useAlphaBlending && alpha != 0))
+				destination[i] = texels[i];
+			else if (alpha != 0 || (destination[i] & 0xff) != 0xff)
+				destination[i] = RGBtoUINT(alphaBlendColor(destination[i], texels[i]));
+		};
+		int i = 0;
+#ifdef CIDR_SSE2
+		// 4 texels at once if each of them is either copied or leaves the pixel as it is
+		const __m128i alphaMask = _mm_set1_epi32(0xff);
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 4 <= count; i += 4) {
+			__m128i texel = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels + i));
+			__m128i pixel = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + i));
+			__m128i texelAlpha = _mm_and_si128(texel, alphaMask);
+			__m128i transparent = _mm_cmpeq_epi32(texelAlpha, zero);
+			__m128i copy = useAlphaBlending ? _mm_cmpeq_epi32(texelAlpha, alphaMask) : _mm_xor_si128(transparent, _mm_cmpeq_epi32(zero, zero));
+			__m128i keep = _mm_and_si128(transparent, _mm_cmpeq_epi32(_mm_and_si128(pixel, alphaMask), alphaMask));
+			if (_mm_movemask_epi8(_mm_or_si128(copy, keep)) != 0xffff) {
+				for (int j = i; j < i + 4; j++) drawTexel(j);
+				continue;
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_or_si128(_mm_and_si128(copy, texel), _mm_andnot_si128(copy, pixel)));
+		}
+#endif
+		for (; i < count; i++) drawTexel(i);
+	}
+}
+void cdr::Renderer::DrawSprite(const Sprite& sprite, float x, float y, int width, int height) {
+	if (!sprite.IsValid()) return;
+	DrawBitmap(sprite.GetView(), x, y, width, height, 0, 0, sprite.GetWidth(), sprite.GetHeight());
+}
+cdr::RGBA cdr::Renderer::sampleTexture(const cdr::BitmapView& bitmap, float xSrc, float ySrc) const {
 	int fooX = 0;
 	int fooY = 0;
 	
@@ -2919,7 +3530,40 @@ cdr::RGBA cdr::Renderer::sampleTexture(const cdr::Bitmap& bitmap, float xSrc, fl
 		// return c;
 	}
 }
-uint32_t cdr::Renderer::sampleTextureRaw(const cdr::Bitmap& bitmap, float xSrc, float ySrc) const {
+void cdr::Renderer::selectMips(const cdr::BitmapView& bitmap, float lod, cdr::BitmapView& level, cdr::BitmapView& next, float& blend) const {
+	int last = bitmap.GetMipCount() - 1;
+	blend = 0;
+	if (lod <= 0) {
+		level = bitmap;
+	} else if (this->ScaleType == ScaleType::Nearest) {
+		level = bitmap.GetMip(std::min((int)(lod + 0.5f), last));
+	} else {
+		// trilinear, between the two closest levels
+		int index = std::min((int)lod, last);
+		level = bitmap.GetMip(index);
+		if (index < last) {
+			next = bitmap.GetMip(index + 1);
+			blend = lod - index;
+		}
+	}
+}
+cdr::RGBA cdr::Renderer::sampleTextureLod(const cdr::BitmapView& bitmap, float xSrc, float ySrc, float lod) const {
+	BitmapView level;
+	BitmapView next;
+	float blend;
+	selectMips(bitmap, lod, level, next, blend);
+	// NOTE: mips round their size down, so the coordinates are scaled by the actual ratio
+	RGBA near = sampleTexture(level, xSrc * level.GetWidth() / bitmap.GetWidth(), ySrc * level.GetHeight() / bitmap.GetHeight());
+	if (blend == 0) return near;
+	RGBA far = sampleTexture(next, xSrc * next.GetWidth() / bitmap.GetWidth(), ySrc * next.GetHeight() / bitmap.GetHeight());
+	return RGBA(
+		near.r + (far.r - near.r) * blend,
+		near.g + (far.g - near.g) * blend,
+		near.b + (far.b - near.b) * blend,
+		near.a + (far.a - near.a) * blend
+	);
+}
+uint32_t cdr::Renderer::sampleTextureRaw(const cdr::BitmapView& bitmap, float xSrc, float ySrc) const {
 	if(xSrc >= 0 && ySrc >= 0 && xSrc < bitmap.GetWidth() && ySrc < bitmap.GetHeight()) {
 		return bitmap.GetRawPixel(xSrc, ySrc);
 	}  else {
@@ -2964,6 +3608,10 @@ void cdr::Renderer::DrawGlyph(uint8_t glyph, int x, int y, const TextStyle& ts)
 									y -= fontHeight*ts.size; break;
 		}
 	}
+	// the shadow can reach past the glyph
+	int shadowX = ts.shadowOffsetX * ts.size;
+	int shadowY = ts.shadowOffsetY * ts.size;
+	addDamage(x + std::min(shadowX, 0), y + std::min(shadowY, 0), std::ceil(fontWidth * ts.size) + std::abs(shadowX), std::ceil(fontHeight * ts.size) + std::abs(shadowY));
 	for (int i = 0; i < fontWidth * ts.size; i++) {
 		for (int j = 0; j < fontHeight * ts.size; j++) {
 			const RGB& letterPixel = ts.font->GetPixel(letterX * fontWidth + i / ts.size, letterY * fontHeight + j / ts.size);
@@ -2973,13 +3621,13 @@ void cdr::Renderer::DrawGlyph(uint8_t glyph, int x, int y, const TextStyle& ts)
 			if (subX >= GetWidth() || subY >= GetHeight() || subX < 0 || subY < 0) continue;
 			
 			if (letterPixel == RGB::Black && ts.bColor != RGBA::Transparent && GetPixel(subX, subY) != ts.shadowColor) {
-				DrawPixel(ts.bColor, subX, subY);
+				drawPixel(ts.bColor, subX, subY);
 			} else if(letterPixel == RGB::White) {
-				DrawPixel(ts.fColor, subX, subY);
+				drawPixel(ts.fColor, subX, subY);
 				int sx = i/ts.size + ts.shadowOffsetX;
 				int sy = j/ts.size + ts.shadowOffsetY;
 				if (sx < 0 || sy < 0 || sx >= fontWidth || sy >= fontHeight || ts.font->GetPixel(letterX * fontWidth + sx, letterY * fontHeight + sy) == RGB::Black) {
-					DrawPixel(ts.shadowColor, subX + ts.shadowOffsetX*ts.size, subY + ts.shadowOffsetY*ts.size);
+					drawPixel(ts.shadowColor, subX + ts.shadowOffsetX*ts.size, subY + ts.shadowOffsetY*ts.size);
 				}
 			}
 		}
@@ -3007,6 +3655,7 @@ void cdr::Renderer::DrawText(const std::string_view text, const TextStyle& ts) {
 	}
 }
 void cdr::Renderer::DrawText(const std::string_view text, int x, int y, const TextStyle& ts) {
+	CIDR_PROFILE_ZONE("Renderer::DrawText");
 	int fontSizeWidth = ts.font->GetFontWidth();
 	int fontSizeHeight = ts.font->GetFontHeight();
 	int charsRows = ts.font->GetFontSheetWidth() / fontSizeWidth;
@@ -3058,6 +3707,9 @@ void cdr::Renderer::DrawText(const std::string_view text, int x, int y, const Te
 		}
 	}
 	
+	// the shadow can reach past the letters
+	int shadowX = ts.shadowOffsetX * ts.size;
+	int shadowY = ts.shadowOffsetY * ts.size;
 	int caretCol{};
 	int newLineCount{};
 	for (int letterIndex = 0; (unsigned)letterIndex < text.size(); letterIndex++) {
@@ -3080,6 +3732,10 @@ void cdr::Renderer::DrawText(const std::string_view text, int x, int y, const Te
 				start = std::min(ts.font->GetLeftKernel(letterX, letterY), ts.font->GetRightKernel(letterX, letterY));
 				end   = std::max(ts.font->GetLeftKernel(letterX, letterY), ts.font->GetRightKernel(letterX, letterY));
 			}
+			int letterLeft = x + caretCol * ts.size;
+			int letterTop = y + newLineCount * fontSizeHeight;
+			addDamage(letterLeft + std::min(shadowX, 0), letterTop + std::min(shadowY, 0),
+				std::ceil(end * ts.size) - start + std::abs(shadowX), std::ceil(fontSizeHeight * ts.size) + std::abs(shadowY));
 			for (int i = start; i < end * ts.size; i++) {
 				for (int j = 0; j < fontSizeHeight * ts.size; j++) {
 					const RGB& letterPixel = ts.font->GetPixel(letterX * fontSizeWidth + i / ts.size, letterY * fontSizeHeight + j / ts.size);
@@ -3092,14 +3748,14 @@ void cdr::Renderer::DrawText(const std::string_view text, int x, int y, const Te
 					continue;
 					
 					if(ts.bColor != RGBA::Transparent && (letterPixel == RGB::Black || i < 0 || i >= ts.font->GetRightKernel(letterX, letterY) * ts.size) && GetPixel(subX, subY) != ts.shadowColor) {
-						DrawPixel(ts.bColor, subX, subY);
+						drawPixel(ts.bColor, subX, subY);
 					} else if(letterPixel == RGB::White && !(letterPixel == RGB::Black || i < 0 || i >= ts.font->GetRightKernel(letterX, letterY) * ts.size)) {
-						DrawPixel(ts.fColor, subX, subY);
+						drawPixel(ts.fColor, subX, subY);
 						int sx = i/ts.size + ts.shadowOffsetX;
 						int sy = j/ts.size + ts.shadowOffsetY;
 						if((sx < 0 || sy < 0 || sx >= fontSizeWidth || sy >= fontSizeHeight || ts.font->GetPixel(letterX * fontSizeWidth + sx, letterY * fontSizeHeight + sy) == RGB::Black)
 							&& GetPixel(subX + ts.shadowOffsetX*ts.size, subY + ts.shadowOffsetY*ts.size) != ts.fColor) { // HACK: checks if color of pixel is foreground color
-							DrawPixel(ts.shadowColor, subX + ts.shadowOffsetX*ts.size, subY + ts.shadowOffsetY*ts.size);
+							drawPixel(ts.shadowColor, subX + ts.shadowOffsetX*ts.size, subY + ts.shadowOffsetY*ts.size);
 						}
 					}
 				}
@@ -3207,7 +3863,7 @@ bool cdr::Renderer::clampCoords(int& x, int& y, int width, int height) const {
 }
 
 #if 0
-void cdr::Renderer::DrawTriangle(const Bitmap& texture, FPoint tp1, FPoint tp2, FPoint tp3, FPoint p1, FPoint p2, FPoint p3) {
+void cdr::Renderer::DrawTriangle(const BitmapView& texture, FPoint tp1, FPoint tp2, FPoint tp3, FPoint p1, FPoint p2, FPoint p3) {
 	// sort top most point
 	if(p1.y > p2.y) {
 		std::swap(p1, p2);
@@ -4924,33 +5580,315 @@ tem::mat4x4 tem::QuickInverse(const tem::mat4x4& m) {
  ********************************/
 
 #include <stdexcept>
+#include <new>
+#include <thread>
 
 
-/* RGBABitmap *******************************************************************************/
+/* Pixel conversion *******************************************************************************/
+
+namespace {
+// images smaller than that aren't worth starting threads for
+constexpr size_t ParallelPixels{1 << 18};
+constexpr unsigned MaxConversionThreads{8};
+// NOTE: off on the band threads themselves, so nested conversions don't spawn threads again
+thread_local bool parallelConversion{true};
+
+// Calls rows(begin, end) for bands of rows, on several threads if there are enough pixels
+template<typename F>
+void forEachRowBand(int height, size_t pixels, F&& rows) {
+	unsigned threads = parallelConversion && pixels >= ParallelPixels ? std::min(std::thread::hardware_concurrency(), MaxConversionThreads) : 1;
+	threads = std::max(1u, std::min(threads, (unsigned)height));
+	if (threads == 1) {
+		rows(0, height);
+		return;
+	}
+	std::vector<std::thread> workers;
+	int band = (height + threads - 1) / threads;
+	for (unsigned i = 1; i < threads; i++) {
+		int begin = std::min(height, (int)i * band);
+		workers.emplace_back([&rows, begin, end = std::min(height, begin + band)]() {
+			parallelConversion = false;
+			rows(begin, end);
+		});
+	}
+	// the calling thread takes the first band
+	parallelConversion = false;
+	rows(0, std::min(height, band));
+	parallelConversion = true;
+	for (auto& worker : workers) worker.join();
+}
+}
+
+void cdr::SetParallelConversion(bool enable) {
+	parallelConversion = enable;
+}
+
+void cdr::ConvertToRGBA(const uint8_t* source, int components, uint32_t* destination, size_t count) {
+	size_t i = 0;
+	switch (components) {
+		case 1: {
+#ifdef CIDR_SSE2
+			const __m128i alpha = _mm_set1_epi32(0xff);
+			for (; i + 16 <= count; i += 16) {
+				__m128i grey = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+				__m128i lo = _mm_unpacklo_epi8(grey, grey);
+				__m128i hi = _mm_unpackhi_epi8(grey, grey);
+				__m128i* out = reinterpret_cast<__m128i*>(destination + i);
+				_mm_storeu_si128(out + 0, _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha));
+				_mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha));
+				_mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha));
+				_mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha));
+			}
+#endif
+			for (; i < count; i++) {
+				destination[i] = source[i] * 0x01010100u | 0xff;
+			}
+		} break;
+		case 2: {
+			for (; i < count; i++) {
+				destination[i] = source[i * 2] * 0x01010100u | source[i * 2 + 1];
+			}
+		} break;
+		case 3: {
+#ifdef CIDR_SSSE3
+			// NOTE: reads 16 bytes for 4 pixels, so the last ones are left to the scalar loop
+			const __m128i shuffle = _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+			const __m128i alpha = _mm_set1_epi32(0xff);
+			for (; i + 6 <= count; i += 4) {
+				__m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+			}
+#elif defined(CIDR_SSE2)
+			// without a byte shuffle: every lane gets its 3 bytes by shifting the whole register,
+			// then R, G and B are moved to their place like in SwapRGBAtoABGR
+			const __m128i middle = _mm_set1_epi32(0x00ff0000);
+			const __m128i low = _mm_set1_epi32(0x0000ff00);
+			const __m128i alpha = _mm_set1_epi32(0xff);
+			for (; i + 6 <= count; i += 4) {
+				__m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+				__m128i first = _mm_unpacklo_epi32(rgb, _mm_srli_si128(rgb, 3));
+				__m128i second = _mm_unpacklo_epi32(_mm_srli_si128(rgb, 6), _mm_srli_si128(rgb, 9));
+				__m128i pixels = _mm_unpacklo_epi64(first, second);
+				__m128i red = _mm_slli_epi32(pixels, 24);
+				__m128i green = _mm_and_si128(_mm_slli_epi32(pixels, 8), middle);
+				__m128i blue = _mm_and_si128(_mm_srli_epi32(pixels, 8), low);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_or_si128(_mm_or_si128(red, green), _mm_or_si128(blue, alpha)));
+			}
+#endif
+			for (; i < count; i++) {
+				const uint8_t* texel = source + i * 3;
+				destination[i] = (texel[0] << 24) | (texel[1] << 16) | (texel[2] << 8) | 0xff;
+			}
+		} break;
+		case 4: {
+			// NOTE: bytes in R, G, B, A order are ABGR on little endian
+			SwapRGBAtoABGR(reinterpret_cast<const uint32_t*>(source), destination, count);
+		} break;
+		default:
+			throw std::invalid_argument("Cidr: can't convert pixels with " + std::to_string(components) + " components");
+	}
+}
+
+void cdr::SwapRGBAtoABGR(const uint32_t* source, uint32_t* destination, size_t count) {
+	size_t i = 0;
+#if defined(CIDR_SSSE3)
+	const __m128i shuffle = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	for (; i + 4 <= count; i += 4) {
+		__m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_shuffle_epi8(rgba, shuffle));
+	}
+#elif defined(CIDR_SSE2)
+	const __m128i middle = _mm_set1_epi32(0x00ff0000);
+	const __m128i low = _mm_set1_epi32(0x0000ff00);
+	for (; i + 4 <= count; i += 4) {
+		__m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		__m128i outer = _mm_or_si128(_mm_slli_epi32(rgba, 24), _mm_srli_epi32(rgba, 24));
+		__m128i inner = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(rgba, 8), middle), _mm_and_si128(_mm_srli_epi32(rgba, 8), low));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_or_si128(outer, inner));
+	}
+#endif
+	for (; i < count; i++) {
+		destination[i] = UINT_RGBAtoUINT_ABGR(source[i]);
+	}
+}
+
+void cdr::ConvertToTiled(const BitmapView& source, uint32_t* destination) {
+	const int width = source.GetWidth();
+	const int tilesX = (width + TileSize - 1) / TileSize;
+	const int tileRows = (source.GetHeight() + TileSize - 1) / TileSize;
+	forEachRowBand(tileRows, (size_t)width * source.GetHeight(), [&](int begin, int end) {
+		for (int tileY = begin; tileY < end; tileY++) {
+			uint32_t* tileRow = destination + (size_t)tileY * tilesX * TileSize * TileSize;
+			for (int row = 0; row < TileSize; row++) {
+				int y = tileY * TileSize + row;
+				// the padding below the last row
+				if (y >= source.GetHeight()) {
+					for (int tileX = 0; tileX < tilesX; tileX++) {
+						memset(tileRow + tileX * TileSize * TileSize + row * TileSize, 0, TileSize * sizeof(uint32_t));
+					}
+					continue;
+				}
+				const uint32_t* sourceRow = source.GetData() + (size_t)y * source.GetPitch();
+				for (int tileX = 0; tileX < tilesX; tileX++) {
+					uint32_t* tile = tileRow + tileX * TileSize * TileSize + row * TileSize;
+					int count = std::min(TileSize, width - tileX * TileSize);
+					memcpy(tile, sourceRow + tileX * TileSize, count * sizeof(uint32_t));
+					if (count < TileSize) memset(tile + count, 0, (TileSize - count) * sizeof(uint32_t));
+				}
+			}
+		}
+	});
+}
+
+void cdr::ConvertFromTiled(const uint32_t* source, int width, int height, uint32_t* destination, int pitch) {
+	if (!pitch) pitch = width;
+	const int tilesX = (width + TileSize - 1) / TileSize;
+	for (int y = 0; y < height; y++) {
+		const uint32_t* tileRow = source + (size_t)(y / TileSize) * tilesX * TileSize * TileSize + (y % TileSize) * TileSize;
+		uint32_t* row = destination + (size_t)y * pitch;
+		for (int tileX = 0; tileX < tilesX; tileX++) {
+			int count = std::min(TileSize, width - tileX * TileSize);
+			memcpy(row + tileX * TileSize, tileRow + tileX * TileSize * TileSize, count * sizeof(uint32_t));
+		}
+	}
+}
+
+
+/* PixelAllocator *******************************************************************************/
+
+namespace {
+cdr::PixelAllocator* pixelAllocator{nullptr};
+}
+
+cdr::PixelAllocatorStats cdr::PixelAllocator::GetStats() const {
+	return PixelAllocatorStats{allocations, systemAllocations, bytesInUse, bytesPooled};
+}
+uint32_t* cdr::PixelAllocator::allocateAligned(size_t count) {
+	systemAllocations++;
+	return static_cast<uint32_t*>(::operator new(count * sizeof(uint32_t), std::align_val_t{PixelAlignment}));
+}
+void cdr::PixelAllocator::deallocateAligned(uint32_t* pixels) {
+	::operator delete(pixels, std::align_val_t{PixelAlignment});
+}
+
+uint32_t* cdr::AlignedPixelAllocator::Allocate(size_t count) {
+	allocations++;
+	bytesInUse += count * sizeof(uint32_t);
+	return allocateAligned(count);
+}
+void cdr::AlignedPixelAllocator::Deallocate(uint32_t* pixels, size_t count) {
+	if (!pixels) return;
+	bytesInUse -= count * sizeof(uint32_t);
+	deallocateAligned(pixels);
+}
+
+cdr::PooledPixelAllocator::PooledPixelAllocator(size_t maxPooledBytes) : maxPooledBytes{maxPooledBytes} {}
+cdr::PooledPixelAllocator::~PooledPixelAllocator() {
+	Trim();
+}
+int cdr::PooledPixelAllocator::sizeClass(size_t count) {
+	if (count <= size_t(1) << MinClass) return 0;
+	// the power of two below count - 1 and the next SubClassBits bits under it pick the class
+	size_t n = count - 1;
+	int exponent = MinClass;
+	while (n >> (exponent + 1)) exponent++;
+	int sub = (n >> (exponent - SubClassBits)) & ((1 << SubClassBits) - 1);
+	return std::min(1 + ((exponent - MinClass) << SubClassBits) + sub, ClassCount - 1);
+}
+size_t cdr::PooledPixelAllocator::classCapacity(int sizeClass) {
+	if (sizeClass == 0) return size_t(1) << MinClass;
+	int exponent = MinClass + (sizeClass - 1) / (1 << SubClassBits);
+	size_t sub = (sizeClass - 1) % (1 << SubClassBits);
+	return ((size_t(1) << SubClassBits) + sub + 1) << (exponent - SubClassBits);
+}
+uint32_t* cdr::PooledPixelAllocator::Allocate(size_t count) {
+	int index = sizeClass(count);
+	size_t capacity = classCapacity(index);
+	allocations++;
+	bytesInUse += capacity * sizeof(uint32_t);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!pool[index].empty()) {
+			uint32_t* pixels = pool[index].back();
+			pool[index].pop_back();
+			bytesPooled -= capacity * sizeof(uint32_t);
+			return pixels;
+		}
+	}
+	return allocateAligned(capacity);
+}
+void cdr::PooledPixelAllocator::Deallocate(uint32_t* pixels, size_t count) {
+	if (!pixels) return;
+	int index = sizeClass(count);
+	size_t bytes = classCapacity(index) * sizeof(uint32_t);
+	bytesInUse -= bytes;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (bytesPooled + bytes <= maxPooledBytes) {
+			pool[index].push_back(pixels);
+			bytesPooled += bytes;
+			return;
+		}
+	}
+	deallocateAligned(pixels);
+}
+void cdr::PooledPixelAllocator::Trim() {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& buffers : pool) {
+		for (uint32_t* pixels : buffers) deallocateAligned(pixels);
+		buffers.clear();
+	}
+	bytesPooled = 0;
+}
+
+void cdr::SetPixelAllocator(PixelAllocator* allocator) {
+	pixelAllocator = allocator;
+}
+cdr::PixelAllocator& cdr::GetPixelAllocator() {
+	// NOTE: never destroyed, bitmaps with static storage might give their pixels back after exit
+	static PooledPixelAllocator* defaultAllocator = new PooledPixelAllocator();
+	return pixelAllocator ? *pixelAllocator : *defaultAllocator;
+}
+
+
+/* BaseBitmap *******************************************************************************/
+
+void cdr::BaseBitmap::allocate() {
+	allocator = &GetPixelAllocator();
+	data = allocator->Allocate(pitch * height);
+}
+void cdr::BaseBitmap::release() {
+	ClearMips();
+	ClearTiled();
+	if (data) allocator->Deallocate(data, pitch * height);
+	data = nullptr;
+}
 
-cdr::BaseBitmap::BaseBitmap(int width, int height, int numComponents) : 
-	data{new uint32_t[width * height]}, width{width}, height{height}, components{numComponents} { 
-	memset(data, 0, width * height * sizeof(uint32_t));
+cdr::BaseBitmap::BaseBitmap(int width, int height, int numComponents, BitmapInit init, int pitch) : 
+	width{width}, height{height}, pitch{std::max(pitch, width)}, components{numComponents} { 
+	allocate();
+	if (init == BitmapInit::Zero) {
+		memset(data, 0, this->pitch * height * sizeof(uint32_t));
+	}
 }
 cdr::BaseBitmap::BaseBitmap(uint32_t* source, int sourceWidth, int sourceHeight, int sourceComponents) :
-	data{new uint32_t[sourceWidth * sourceHeight]}, width{sourceWidth}, height{sourceHeight}, components{sourceComponents} {
+	width{sourceWidth}, height{sourceHeight}, pitch{sourceWidth}, components{sourceComponents} {
+	allocate();
 	memcpy(data, source, width * height * sizeof(uint32_t));
 }
 cdr::BaseBitmap::BaseBitmap(std::string_view file, int reqComponents) {
-	uint8_t* imageData = stbi_load(file.data(), &this->width, &this->height, &this->components, reqComponents);
-	this->components = reqComponents;
+	int fileComponents = 0;
+	uint8_t* imageData = stbi_load(file.data(), &this->width, &this->height, &fileComponents, reqComponents);
+	// NOTE: stb_image converts to reqComponents, unless it's 0
+	this->components = reqComponents ? reqComponents : fileComponents;
+	this->pitch = width;
 	if(imageData) {
-		data = new uint32_t[width * height];
-		for(int i = 0; i < width; i++) {
-			for (int j = 0; j < height; j++) {
-				// NOTE: this handles the cases where the image is monochrome, rgb or rgba (and maybe other cases, haven't tested)
-				data[i + j * width] = 
-					(imageData[(i + j * width) * components + 0] << 24) + 
-					(imageData[(i + j * width) * components + 1] << 16) + 
-					(imageData[(i + j * width) * components + 2] <<  8) + 
-					((components == 4) ? (imageData[(i + j * width) * components + 3] <<  0) : 0xff);
+		allocate();
+		forEachRowBand(height, (size_t)width * height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++) {
+				ConvertToRGBA(imageData + (size_t)y * width * components, components, data + (size_t)y * pitch, width);
 			}
-		}
+		});
 		stbi_image_free(imageData);
 	} else {
 		throw std::runtime_error("Cidr: Bitmap not found (" + std::string(file) + ")");
@@ -4958,76 +5896,264 @@ cdr::BaseBitmap::BaseBitmap(std::string_view file, int reqComponents) {
 }
 
 cdr::BaseBitmap::BaseBitmap(const BaseBitmap& other) : 
-	data{new uint32_t[other.width * other.height]}, width{other.width}, height{other.height}, components{other.components} { 
-	memcpy(data, other.data, width * height * sizeof(uint32_t));
+	width{other.width}, height{other.height}, pitch{other.pitch}, components{other.components} { 
+	allocate();
+	memcpy(data, other.data, pitch * height * sizeof(uint32_t));
+	copyMips(other);
 }
 cdr::BaseBitmap& cdr::BaseBitmap::operator=(const BaseBitmap& other) {
-	delete[] data;
+	if(this == &other) return *this;
+	
+	release();
 	this->width = other.width;
 	this->height = other.height;
+	this->pitch = other.pitch;
 	this->components = other.components;
-	data = new uint32_t[width * height];
-	memcpy(data, other.data, width * height * sizeof(uint32_t));
+	allocate();
+	memcpy(data, other.data, pitch * height * sizeof(uint32_t));
+	copyMips(other);
 	
 	return *this;
 }
 cdr::BaseBitmap::BaseBitmap(BaseBitmap&& other) noexcept : 
-	data{other.data} , width{other.width}, height{other.height}, components{other.components} { 
+	data{other.data} , width{other.width}, height{other.height}, pitch{other.pitch}, components{other.components}, allocator{other.allocator},
+	mipData{other.mipData}, mipPixels{other.mipPixels}, mips{std::move(other.mips)},
+	tiledData{other.tiledData}, tiledDirty{other.tiledDirty} { 
 	other.width = 0;
 	other.height = 0;
+	other.pitch = 0;
+	other.components = 0;
 	other.data = nullptr;
+	other.mipData = nullptr;
+	other.mipPixels = 0;
+	other.mips.clear();
+	other.tiledData = nullptr;
 }
 cdr::BaseBitmap& cdr::BaseBitmap::operator=(BaseBitmap&& other) noexcept {
 	if(this == &other) return *this;
 	
-	delete[] data;
+	release();
 	this->width = other.width;
 	this->height = other.height;
+	this->pitch = other.pitch;
 	this->components = other.components;
 	data = other.data;
+	allocator = other.allocator;
+	// NOTE: moving the vector keeps its buffer, so views of other now see this bitmap's mips
+	mipData = other.mipData;
+	mipPixels = other.mipPixels;
+	mips = std::move(other.mips);
+	tiledData = other.tiledData;
+	tiledDirty = other.tiledDirty;
 	other.width = 0;
 	other.height = 0;
+	other.pitch = 0;
 	other.components = 0;
 	other.data = nullptr;
+	other.mipData = nullptr;
+	other.mipPixels = 0;
+	other.mips.clear();
+	other.tiledData = nullptr;
 	
 	return *this;
 }
 
 cdr::BaseBitmap::~BaseBitmap() {
-	delete[] data;
+	release();
 }
 
 // provie filename without extension!
 void cdr::BaseBitmap::SaveAs(const std::string& fileName, Formats format, int quality) {
-	// NOTE: Cidr uses rgba, stbi uses abgr
-	uint32_t* abgrData = new uint32_t[this->width * this->height];
-	for (int i = 0; i < this->width * this->height; i++) {
-		abgrData[i] = UINT_RGBAtoUINT_ABGR(data[i]);
+	// NOTE: Cidr uses rgba, stbi uses abgr. RGBA bitmaps are swapped in place and written straight
+	// from their rows (only PNG takes a stride for padded rows), then swapped back.
+	bool inPlace = components == 4 && (format == Formats::PNG || pitch == width);
+	std::vector<uint32_t> packed;
+	const void* pixels = data;
+	int stride = pitch * sizeof(uint32_t);
+	size_t pixelCount = (size_t)width * height;
+	
+	if (inPlace) {
+		forEachRowBand(height, pixelCount, [&](int begin, int end) {
+			SwapRGBAtoABGR(data + (size_t)begin * pitch, data + (size_t)begin * pitch, (size_t)(end - begin) * pitch);
+		});
+	} else {
+		// the encoders want tightly packed pixels with components bytes each
+		static constexpr int shifts[4][4] {{24}, {24, 0}, {24, 16, 8}, {24, 16, 8, 0}};
+		packed.resize((pixelCount * components + 3) / 4);
+		uint8_t* bytes = reinterpret_cast<uint8_t*>(packed.data());
+		forEachRowBand(height, pixelCount, [&](int begin, int end) {
+			for (int y = begin; y < end; y++) {
+				const uint32_t* source = data + (size_t)y * pitch;
+				if (components == 4) {
+					SwapRGBAtoABGR(source, packed.data() + (size_t)y * width, width);
+					continue;
+				}
+				uint8_t* row = bytes + (size_t)y * width * components;
+				for (int x = 0; x < width; x++) {
+					for (int c = 0; c < components; c++) {
+						row[x * components + c] = source[x] >> shifts[components - 1][c];
+					}
+				}
+			}
+		});
+		pixels = packed.data();
+		stride = width * components;
 	}
 	
 	// NOTE: Extension added depending on format argument 
 	switch(format) {
 		case Formats::PNG:
-			stbi_write_png((fileName + ".png").c_str(), GetWidth(), GetHeight(), this->components, abgrData, this->components * GetWidth());
+			stbi_write_png((fileName + ".png").c_str(), GetWidth(), GetHeight(), this->components, pixels, stride);
 			break;
 		case Formats::BMP:
-			stbi_write_bmp((fileName + ".bmp").c_str(), GetWidth(), GetHeight(), this->components, abgrData);
+			stbi_write_bmp((fileName + ".bmp").c_str(), GetWidth(), GetHeight(), this->components, pixels);
 			break;
 		case Formats::TGA:
-			stbi_write_tga((fileName + ".tga").c_str(), GetWidth(), GetHeight(), this->components, abgrData);
+			stbi_write_tga((fileName + ".tga").c_str(), GetWidth(), GetHeight(), this->components, pixels);
 			break;
 		case Formats::JPG:
-			stbi_write_jpg((fileName + ".jpg").c_str(), GetWidth(), GetHeight(), this->components, abgrData, quality);
+			stbi_write_jpg((fileName + ".jpg").c_str(), GetWidth(), GetHeight(), this->components, pixels, quality);
 			break;
 	}
 	
-	delete[] abgrData;
+	if (inPlace) {
+		forEachRowBand(height, pixelCount, [&](int begin, int end) {
+			SwapRGBAtoABGR(data + (size_t)begin * pitch, data + (size_t)begin * pitch, (size_t)(end - begin) * pitch);
+		});
+	}
+}
+
+
+/* Mip chains *******************************************************************************/
+
+namespace {
+// Averages 2x2 blocks of two source rows into count pixels. The rows have at least 2 * count
+// pixels, unless single is set, then they are one pixel wide and count is 1.
+void boxFilterRow(const uint32_t* row0, const uint32_t* row1, uint32_t* destination, int count, bool single) {
+	int x = 0;
+#ifdef CIDR_SSE2
+	if (!single) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+		for (; x + 4 <= count; x += 4) {
+			__m128i top0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2));
+			__m128i top1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2 + 4));
+			__m128i bottom0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2));
+			__m128i bottom1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2 + 4));
+			// columns summed in 16 bits, two source pixels per register
+			__m128i a = _mm_add_epi16(_mm_unpacklo_epi8(top0, zero), _mm_unpacklo_epi8(bottom0, zero));
+			__m128i b = _mm_add_epi16(_mm_unpackhi_epi8(top0, zero), _mm_unpackhi_epi8(bottom0, zero));
+			__m128i c = _mm_add_epi16(_mm_unpacklo_epi8(top1, zero), _mm_unpacklo_epi8(bottom1, zero));
+			__m128i d = _mm_add_epi16(_mm_unpackhi_epi8(top1, zero), _mm_unpackhi_epi8(bottom1, zero));
+			// neighbouring columns added, rounded and divided by 4
+			__m128i ab = _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+			__m128i cd = _mm_add_epi16(_mm_unpacklo_epi64(c, d), _mm_unpackhi_epi64(c, d));
+			ab = _mm_srli_epi16(_mm_add_epi16(ab, two), 2);
+			cd = _mm_srli_epi16(_mm_add_epi16(cd, two), 2);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), _mm_packus_epi16(ab, cd));
+		}
+	}
+#endif
+	for (; x < count; x++) {
+		int left = single ? 0 : x * 2;
+		int right = single ? 0 : x * 2 + 1;
+		uint32_t pixel = 0;
+		for (int shift = 0; shift < 32; shift += 8) {
+			uint32_t sum = ((row0[left] >> shift) & 0xff) + ((row0[right] >> shift) & 0xff) + ((row1[left] >> shift) & 0xff) + ((row1[right] >> shift) & 0xff);
+			pixel |= ((sum + 2) >> 2) << shift;
+		}
+		destination[x] = pixel;
+	}
+}
+}
+
+void cdr::BaseBitmap::GenerateMips(int maxLevels) {
+	CIDR_PROFILE_ZONE("BaseBitmap::GenerateMips");
+	ClearMips();
+	if (!data) return;
+	
+	// NOTE: odd sizes round down, the last row or column is left out of the average
+	std::vector<BitmapView> levels;
+	std::vector<size_t> offsets;
+	int levelWidth = width;
+	int levelHeight = height;
+	while ((levelWidth > 1 || levelHeight > 1) && (maxLevels <= 0 || (int)levels.size() + 1 < maxLevels)) {
+		levelWidth = std::max(1, levelWidth / 2);
+		levelHeight = std::max(1, levelHeight / 2);
+		int levelPitch = AlignedPitch(levelWidth);
+		levels.emplace_back(nullptr, levelWidth, levelHeight, levelPitch);
+		offsets.push_back(mipPixels);
+		mipPixels += (size_t)levelPitch * levelHeight;
+	}
+	if (levels.empty()) return;
+	
+	mipData = allocator->Allocate(mipPixels);
+	mips.reserve(levels.size());
+	BitmapView source{data, width, height, pitch};
+	for (size_t i = 0; i < levels.size(); i++) {
+		uint32_t* destination = mipData + offsets[i];
+		const BitmapView& level = levels[i];
+		forEachRowBand(level.GetHeight(), (size_t)source.GetWidth() * source.GetHeight(), [&](int begin, int end) {
+			for (int y = begin; y < end; y++) {
+				const uint32_t* row0 = source.GetData() + (size_t)std::min(y * 2, source.GetHeight() - 1) * source.GetPitch();
+				const uint32_t* row1 = source.GetData() + (size_t)std::min(y * 2 + 1, source.GetHeight() - 1) * source.GetPitch();
+				boxFilterRow(row0, row1, destination + (size_t)y * level.GetPitch(), level.GetWidth(), source.GetWidth() == 1);
+			}
+		});
+		mips.emplace_back(destination, level.GetWidth(), level.GetHeight(), level.GetPitch());
+		source = mips.back();
+	}
+}
+
+void cdr::BaseBitmap::ClearMips() {
+	if (mipData) allocator->Deallocate(mipData, mipPixels);
+	mipData = nullptr;
+	mipPixels = 0;
+	mips.clear();
+}
+
+int cdr::BaseBitmap::GetMipCount() const {
+	return 1 + (int)mips.size();
+}
+
+void cdr::BaseBitmap::MakeTiled() {
+	if (!data) return;
+	if (!tiledData) {
+		tiledData = allocator->Allocate(TiledPixelCount(width, height));
+		tiledDirty = true;
+	}
+	if (tiledDirty) {
+		CIDR_PROFILE_ZONE("BaseBitmap::MakeTiled");
+		ConvertToTiled(BitmapView{data, width, height, pitch}, tiledData);
+		tiledDirty = false;
+	}
+}
+
+const uint32_t* cdr::BaseBitmap::GetTiled() const {
+	return tiledDirty ? nullptr : tiledData;
+}
+
+void cdr::BaseBitmap::ClearTiled() {
+	if (tiledData) allocator->Deallocate(tiledData, TiledPixelCount(width, height));
+	tiledData = nullptr;
+	tiledDirty = true;
+}
+
+void cdr::BaseBitmap::copyMips(const BaseBitmap& other) {
+	if (!other.mipData) return;
+	mipPixels = other.mipPixels;
+	mipData = allocator->Allocate(mipPixels);
+	memcpy(mipData, other.mipData, mipPixels * sizeof(uint32_t));
+	mips.reserve(other.mips.size());
+	for (const BitmapView& level : other.mips) {
+		mips.emplace_back(mipData + (level.GetData() - other.mipData), level.GetWidth(), level.GetHeight(), level.GetPitch());
+	}
 }
 
 
 /* RGBABitmap *******************************************************************************/
 
-cdr::RGBABitmap::RGBABitmap(int width, int height) : BaseBitmap(width, height, 4) {}
+cdr::RGBABitmap::RGBABitmap(int width, int height, BitmapInit init, int pitch) : BaseBitmap(width, height, 4, init, pitch) {}
 cdr::RGBABitmap::RGBABitmap(uint32_t* source, int sourceWidth, int sourceHeight) : BaseBitmap(source, sourceWidth, sourceHeight, 4) {}
 cdr::RGBABitmap::RGBABitmap(std::string_view file) : BaseBitmap(file, 4) {}
 
@@ -5036,9 +6162,9 @@ cdr::RGBABitmap& cdr::RGBABitmap::operator=(const RGBABitmap& other) {
 	BaseBitmap::operator=(other);
 	return *this;
 }
-cdr::RGBABitmap::RGBABitmap(RGBABitmap&& other) noexcept : BaseBitmap(other) {}
+cdr::RGBABitmap::RGBABitmap(RGBABitmap&& other) noexcept : BaseBitmap(std::move(other)) {}
 cdr::RGBABitmap& cdr::RGBABitmap::operator=(RGBABitmap&& other) noexcept {
-	BaseBitmap::operator=(other);
+	BaseBitmap::operator=(std::move(other));
 	return *this;
 }
 cdr::RGBABitmap::~RGBABitmap() {}
@@ -5046,7 +6172,7 @@ cdr::RGBABitmap::~RGBABitmap() {}
 
 /* RGBBitmap *******************************************************************************/
 
-cdr::RGBBitmap::RGBBitmap(int width, int height) : BaseBitmap(width, height, 3) {}
+cdr::RGBBitmap::RGBBitmap(int width, int height, BitmapInit init, int pitch) : BaseBitmap(width, height, 3, init, pitch) {}
 cdr::RGBBitmap::RGBBitmap(uint32_t* source, int sourceWidth, int sourceHeight) : BaseBitmap(source, sourceWidth, sourceHeight, 4) {}
 cdr::RGBBitmap::RGBBitmap(std::string_view file) : BaseBitmap(file, 3) {}
 
@@ -5055,9 +6181,9 @@ cdr::RGBBitmap& cdr::RGBBitmap::operator=(const RGBBitmap& other) {
 	BaseBitmap::operator=(other);
 	return *this;
 }
-cdr::RGBBitmap::RGBBitmap(RGBBitmap&& other) noexcept : BaseBitmap(other) {}
+cdr::RGBBitmap::RGBBitmap(RGBBitmap&& other) noexcept : BaseBitmap(std::move(other)) {}
 cdr::RGBBitmap& cdr::RGBBitmap::operator=(RGBBitmap&& other) noexcept {
-	BaseBitmap::operator=(other);
+	BaseBitmap::operator=(std::move(other));
 	return *this;
 }
 cdr::RGBBitmap::~RGBBitmap() {}
@@ -5159,6 +6285,113 @@ cdr::FRectangle::operator cdr::Rectangle() const {
 
 #pragma endregion RECTANGLE_CPP
 
+#pragma region ATLAS_CPP
+
+/********************************
+ * Project: Cidr				*
+ * File: atlas.cpp				*
+ * Date: 19.10.2026				*
+ ********************************/
+
+cdr::TextureAtlas::TextureAtlas(int width, int height, int padding) : 
+	bitmap{width, height, BitmapInit::Zero, BaseBitmap::AlignedPitch(width)}, padding{std::max(padding, 0)} {
+	Clear();
+}
+
+cdr::Sprite cdr::TextureAtlas::Add(const BitmapView& source) {
+	CIDR_PROFILE_ZONE("TextureAtlas::Add");
+	if (source.GetWidth() <= 0 || source.GetHeight() <= 0) return Sprite{};
+	
+	// NOTE: the padding is part of the block, sprites as big as the atlas go without it
+	int blockWidth = (source.GetWidth() + padding + SpriteAlignment - 1) / SpriteAlignment * SpriteAlignment;
+	int blockHeight = source.GetHeight() + padding;
+	blockWidth = std::max(std::min(blockWidth, bitmap.GetWidth()), source.GetWidth());
+	blockHeight = std::max(std::min(blockHeight, bitmap.GetHeight()), source.GetHeight());
+	int x, y;
+	size_t segment;
+	if (!findPosition(blockWidth, blockHeight, x, y, segment)) return Sprite{};
+	place(segment, x, y, blockWidth, blockHeight);
+	
+	for (int row = 0; row < source.GetHeight(); row++) {
+		memcpy(bitmap.GetData() + (size_t)(y + row) * bitmap.GetPitch() + x, source.GetData() + (size_t)row * source.GetPitch(), source.GetWidth() * sizeof(uint32_t));
+	}
+	usedPixels += (size_t)source.GetWidth() * source.GetHeight();
+	spriteCount++;
+	return Sprite{BitmapView{bitmap}, Rectangle{x, y, source.GetWidth(), source.GetHeight()}};
+}
+
+std::vector<cdr::Sprite> cdr::TextureAtlas::Add(const std::vector<BitmapView>& sources) {
+	std::vector<size_t> order(sources.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		if (sources[a].GetHeight() != sources[b].GetHeight()) return sources[a].GetHeight() > sources[b].GetHeight();
+		return sources[a].GetWidth() > sources[b].GetWidth();
+	});
+	std::vector<Sprite> sprites(sources.size());
+	for (size_t i : order) sprites[i] = Add(sources[i]);
+	return sprites;
+}
+
+void cdr::TextureAtlas::Clear() {
+	memset(bitmap.GetData(), 0, (size_t)bitmap.GetPitch() * bitmap.GetHeight() * sizeof(uint32_t));
+	skyline.assign(1, SkylineSegment{0, 0, bitmap.GetWidth()});
+	usedPixels = 0;
+	spriteCount = 0;
+}
+
+float cdr::TextureAtlas::GetOccupancy() const {
+	size_t pixels = (size_t)bitmap.GetWidth() * bitmap.GetHeight();
+	return pixels ? usedPixels / (float)pixels : 0;
+}
+
+// bottom left: the spot where the block's bottom ends up the highest, the leftmost of those
+bool cdr::TextureAtlas::findPosition(int width, int height, int& bestX, int& bestY, size_t& bestSegment) const {
+	int bestBottom = std::numeric_limits<int>::max();
+	for (size_t i = 0; i < skyline.size(); i++) {
+		int x = skyline[i].x;
+		if (x + width > bitmap.GetWidth()) break;
+		// the block rests on the highest segment below it
+		int y = 0;
+		int covered = 0;
+		for (size_t j = i; covered < width; j++) {
+			y = std::max(y, skyline[j].y);
+			covered += skyline[j].width;
+		}
+		if (y + height > bitmap.GetHeight() || y + height >= bestBottom) continue;
+		bestBottom = y + height;
+		bestX = x;
+		bestY = y;
+		bestSegment = i;
+	}
+	return bestBottom != std::numeric_limits<int>::max();
+}
+
+void cdr::TextureAtlas::place(size_t segment, int x, int y, int width, int height) {
+	skyline.insert(skyline.begin() + segment, SkylineSegment{x, y + height, width});
+	// the segments under the block shrink or disappear
+	for (size_t i = segment + 1; i < skyline.size();) {
+		int overlap = x + width - skyline[i].x;
+		if (overlap <= 0) break;
+		if (overlap < skyline[i].width) {
+			skyline[i].x += overlap;
+			skyline[i].width -= overlap;
+			break;
+		}
+		skyline.erase(skyline.begin() + i);
+	}
+	// neighbours at the same height become one
+	for (size_t i = 0; i + 1 < skyline.size();) {
+		if (skyline[i].y == skyline[i + 1].y) {
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		} else {
+			i++;
+		}
+	}
+}
+
+#pragma endregion ATLAS_CPP
+
 #pragma region COLOR_CPP
 
 /********************************
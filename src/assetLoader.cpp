@@ -0,0 +1,166 @@
+#include "assetLoader.hpp"
+
+#include <algorithm>
+#include "profiler.hpp"
+
+static const std::string emptyString;
+
+const cdr::Bitmap* AssetLoader::Handle::Get() const {
+	return IsReady() ? entry->bitmap.get() : nullptr;
+}
+
+const cdr::Bitmap* AssetLoader::Handle::Wait() const {
+	return entry ? entry->future.get().get() : nullptr;
+}
+
+const std::string& AssetLoader::Handle::GetError() const {
+	return IsFailed() ? entry->error : emptyString;
+}
+
+const std::string& AssetLoader::Handle::GetPath() const {
+	return entry ? entry->path : emptyString;
+}
+
+std::shared_future<std::shared_ptr<const cdr::Bitmap>> AssetLoader::Handle::GetFuture() const {
+	return entry ? entry->future : std::shared_future<std::shared_ptr<const cdr::Bitmap>>{};
+}
+
+AssetLoader::AssetLoader(int threads, size_t cacheBytes, bool mips, bool tiled) : cacheBytes(cacheBytes), mips(mips), tiled(tiled) {
+	if (threads <= 0) {
+		threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	}
+	for (int i = 0; i < threads; i++) {
+		workers.emplace_back(&AssetLoader::work, this);
+	}
+}
+
+AssetLoader::~AssetLoader() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+	for (auto& worker : workers) worker.join();
+
+	// nobody is going to decode them anymore, don't leave anyone waiting
+	for (auto& entry : queue) {
+		entry->error = "Loader destroyed";
+		entry->state = State::Failed;
+		entry->promise.set_value(nullptr);
+	}
+}
+
+AssetLoader::Handle AssetLoader::Load(const std::string& path) {
+	std::shared_ptr<Entry> entry;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.requests++;
+		auto found = entries.find(path);
+		if (found != entries.end()) {
+			stats.hits++;
+			if (found->second->cached) {
+				lru.splice(lru.begin(), lru, found->second->lru);
+			}
+			return Handle(found->second);
+		}
+
+		entry = std::make_shared<Entry>();
+		entry->path = path;
+		entries.emplace(path, entry);
+		queue.push_back(entry);
+	}
+	queueCondition.notify_one();
+	return Handle(entry);
+}
+
+void AssetLoader::SetCacheBytes(size_t bytes) {
+	std::lock_guard<std::mutex> lock(mutex);
+	cacheBytes = bytes;
+	evict();
+}
+
+void AssetLoader::Clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const std::string& path : lru) {
+		auto found = entries.find(path);
+		found->second->cached = false;
+		entries.erase(found);
+	}
+	lru.clear();
+	stats.cachedBytes = 0;
+}
+
+size_t AssetLoader::GetCacheBytes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return cacheBytes;
+}
+
+AssetLoader::Stats AssetLoader::GetStats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void AssetLoader::work() {
+	Profiler::SetThreadName("asset loader");
+	// the workers already decode next to each other, splitting every image into bands would oversubscribe
+	cdr::SetParallelConversion(false);
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		queueCondition.wait(lock, [&]{ return stopping || !queue.empty(); });
+		if (stopping) return;
+
+		std::shared_ptr<Entry> entry = std::move(queue.front());
+		queue.pop_front();
+		lock.unlock();
+		decode(*entry);
+		lock.lock();
+
+		if (entry->bitmap) {
+			stats.decoded++;
+			entry->cached = true;
+			entry->lru = lru.insert(lru.begin(), entry->path);
+			stats.cachedBytes += entry->bytes;
+			entry->state = State::Ready;
+			evict();
+		} else {
+			// the next request tries again
+			stats.failed++;
+			auto found = entries.find(entry->path);
+			if (found != entries.end() && found->second == entry) entries.erase(found);
+			entry->state = State::Failed;
+		}
+		entry->promise.set_value(entry->bitmap);
+	}
+}
+
+void AssetLoader::decode(Entry& entry) {
+	PROFILE_ZONE("decode");
+	try {
+		auto bitmap = std::make_shared<cdr::Bitmap>(entry.path);
+		if (mips) bitmap->GenerateMips();
+		// NOTE: built here, the bitmap is shared between threads once it's ready
+		if (tiled) bitmap->MakeTiled();
+		cdr::BitmapView view = *bitmap;
+		entry.bytes = 0;
+		for (int level = 0; level < view.GetMipCount(); level++) {
+			entry.bytes += (size_t)view.GetMip(level).GetPitch() * view.GetMip(level).GetHeight() * sizeof(uint32_t);
+		}
+		if (bitmap->GetTiled()) {
+			entry.bytes += cdr::TiledPixelCount(view.GetWidth(), view.GetHeight()) * sizeof(uint32_t);
+		}
+		entry.bitmap = std::move(bitmap);
+	} catch (const std::exception& e) {
+		entry.error = e.what();
+	}
+}
+
+void AssetLoader::evict() {
+	while (stats.cachedBytes > cacheBytes && !lru.empty()) {
+		auto found = entries.find(lru.back());
+		stats.cachedBytes -= found->second->bytes;
+		found->second->cached = false;
+		entries.erase(found);
+		lru.pop_back();
+		stats.evicted++;
+	}
+}
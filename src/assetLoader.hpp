@@ -0,0 +1,124 @@
+#ifndef ASSET_LOADER_HPP
+#define ASSET_LOADER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "cidr.hpp"
+
+// Decodes images on a pool of worker threads. Requests for a path that is already loading or
+// loaded share the same bitmap, decoded bitmaps are kept in an LRU cache of up to
+// GetCacheBytes(). Handles keep their bitmap alive even after it got evicted from the cache.
+class AssetLoader {
+public:
+	static constexpr size_t DefaultCacheBytes = 256 << 20;
+
+	enum class State {
+		Loading,
+		Ready,
+		Failed,
+		// a default constructed or reset handle
+		Invalid,
+	};
+
+	struct Stats {
+		uint64_t requests{0};
+		// requests that got a bitmap that was loading or loaded already
+		uint64_t hits{0};
+		uint64_t decoded{0};
+		uint64_t failed{0};
+		uint64_t evicted{0};
+		size_t cachedBytes{0};
+	};
+
+private:
+	struct Entry {
+		std::string path;
+		std::atomic<State> state{State::Loading};
+		std::shared_ptr<const cdr::Bitmap> bitmap;
+		std::string error;
+		std::promise<std::shared_ptr<const cdr::Bitmap>> promise;
+		std::shared_future<std::shared_ptr<const cdr::Bitmap>> future{promise.get_future().share()};
+		size_t bytes{0};
+		std::list<std::string>::iterator lru;
+		bool cached{false};
+	};
+
+public:
+	// Poll it every frame, or wait for it
+	class Handle {
+	public:
+		Handle() = default;
+
+		// a default constructed handle isn't loading anything, it's neither ready nor failed
+		inline bool IsValid() const { return entry != nullptr; }
+		inline State GetState() const { return entry ? entry->state.load() : State::Invalid; }
+		inline bool IsReady() const { return entry && entry->state == State::Ready; }
+		inline bool IsFailed() const { return entry && entry->state == State::Failed; }
+		// nullptr until the bitmap is ready
+		const cdr::Bitmap* Get() const;
+		// Blocks until the bitmap is decoded, nullptr if it failed
+		const cdr::Bitmap* Wait() const;
+		// why it failed
+		const std::string& GetError() const;
+		const std::string& GetPath() const;
+		// the bitmap, or nullptr if it failed
+		std::shared_future<std::shared_ptr<const cdr::Bitmap>> GetFuture() const;
+
+	private:
+		friend class AssetLoader;
+		explicit Handle(std::shared_ptr<Entry> entry) : entry(std::move(entry)) {}
+
+		std::shared_ptr<Entry> entry;
+	};
+
+	// threads 0 uses one less than there are cores, but at least one. With mips every bitmap gets
+	// its mip chain generated after decoding, with tiled its tiled copy for rotated draws (see
+	// cdr::BaseBitmap::MakeTiled()). Both count towards the cache size.
+	explicit AssetLoader(int threads = 0, size_t cacheBytes = DefaultCacheBytes, bool mips = false, bool tiled = false);
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// Queues the image for decoding unless it's loading or cached already
+	Handle Load(const std::string& path);
+	// Evicts the least recently used bitmaps until they fit
+	void SetCacheBytes(size_t bytes);
+	// Drops every bitmap that isn't loading, handles still keep theirs
+	void Clear();
+
+	size_t GetCacheBytes() const;
+	Stats GetStats() const;
+
+private:
+	mutable std::mutex mutex;
+	std::condition_variable queueCondition;
+	std::deque<std::shared_ptr<Entry>> queue;
+	std::vector<std::thread> workers;
+	bool stopping{false};
+
+	std::unordered_map<std::string, std::shared_ptr<Entry>> entries;
+	// most recently used first, only entries that are ready
+	std::list<std::string> lru;
+	size_t cacheBytes;
+	bool mips;
+	bool tiled;
+	Stats stats;
+
+	void work();
+	void decode(Entry& entry);
+	// needs the lock
+	void evict();
+};
+
+#endif /* ASSET_LOADER_HPP */
@@ -0,0 +1,161 @@
+#include "compressedMap.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+CompressedMap::CompressedMap(const TileView& tiles) {
+	Compress(tiles);
+}
+
+void CompressedMap::Compress(const TileView& tiles) {
+	width = tiles.GetWidth();
+	height = tiles.GetHeight();
+	paletteCount = 0;
+	codes.fill(-1);
+	rows.assign(height, Row{});
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			encode(tiles[y][x]);
+		}
+	}
+	for (int i = 0; i < 256; i++) {
+		pairs[i] = { palette[i & 0xf], palette[i >> 4] };
+	}
+
+	for (int y = 0; y < height; y++) {
+		Row& row = rows[y];
+		runLengthEncode(row, tiles[y]);
+		if (row.runs.size() * sizeof(uint32_t) >= (size_t)(width + 1) / 2) {
+			// the runs lose, drop them so the row is actually hot
+			row.runs.clear();
+			row.runs.shrink_to_fit();
+			pack(row, tiles[y]);
+		}
+	}
+}
+
+char CompressedMap::At(int x, int y) const {
+	return palette[codeAt(rows[y], x)];
+}
+
+void CompressedMap::Set(int x, int y, char tile) {
+	uint8_t code = encode(tile);
+	// the code might be new, so refresh every pair it's part of
+	for (int i = 0; i < PaletteSize; i++) {
+		pairs[code | i << 4] = { tile, palette[i] };
+		pairs[i | code << 4] = { palette[i], tile };
+	}
+
+	MakeHot(y, y);
+	uint8_t& byte = rows[y].packed[x / 2];
+	byte = (x & 1) ? (byte & 0x0f) | code << 4 : (byte & 0xf0) | code;
+}
+
+void CompressedMap::DecompressRow(int y, int x, int count, char* out) const {
+	if (count <= 0) return;
+	const Row& row = rows[y];
+	int end = x + count;
+
+	if (row.runs.empty()) {
+		if (x & 1) {
+			*out++ = palette[row.packed[x / 2] >> 4];
+			x++;
+		}
+		// whole bytes decode to two tiles at once
+		for (; x + 1 < end; x += 2) {
+			const auto& pair = pairs[row.packed[x / 2]];
+			out[0] = pair[0];
+			out[1] = pair[1];
+			out += 2;
+		}
+		if (x < end) {
+			*out = palette[row.packed[x / 2] & 0xf];
+		}
+		return;
+	}
+
+	auto run = std::upper_bound(row.runs.begin(), row.runs.end(), (uint32_t)x << 4 | 0xf);
+	while (x < end) {
+		int runEnd = std::min<int>(*run >> 4, end);
+		std::fill(out, out + (runEnd - x), palette[*run & 0xf]);
+		out += runEnd - x;
+		x = runEnd;
+		run++;
+	}
+}
+
+void CompressedMap::MakeHot(int firstRow, int lastRow) {
+	std::vector<char> scratch(width);
+	for (int y = std::max(firstRow, 0); y <= std::min(lastRow, height - 1); y++) {
+		Row& row = rows[y];
+		if (row.runs.empty()) continue;
+
+		DecompressRow(y, scratch.data());
+		row.runs.clear();
+		row.runs.shrink_to_fit();
+		pack(row, scratch.data());
+	}
+}
+
+void CompressedMap::MakeCold(int firstRow, int lastRow) {
+	std::vector<char> scratch(width);
+	for (int y = std::max(firstRow, 0); y <= std::min(lastRow, height - 1); y++) {
+		Row& row = rows[y];
+		if (!row.runs.empty()) continue;
+
+		DecompressRow(y, scratch.data());
+		Row encoded;
+		runLengthEncode(encoded, scratch.data());
+		if (encoded.runs.size() * sizeof(uint32_t) < row.packed.size()) {
+			row = std::move(encoded);
+		}
+	}
+}
+
+size_t CompressedMap::GetMemoryUsage() const {
+	size_t bytes = 0;
+	for (const auto& row : rows) {
+		bytes += row.packed.capacity() + row.runs.capacity() * sizeof(uint32_t);
+	}
+	return bytes;
+}
+
+uint8_t CompressedMap::encode(char tile) {
+	int8_t& code = codes[(uint8_t)tile];
+	if (code < 0) {
+		if (paletteCount == PaletteSize) {
+			throw std::runtime_error("CompressedMap: more than " + std::to_string(PaletteSize) + " distinct tiles");
+		}
+		palette[paletteCount] = tile;
+		code = paletteCount++;
+	}
+	return code;
+}
+
+void CompressedMap::pack(Row& row, const char* tiles) {
+	row.packed.assign((width + 1) / 2, 0);
+	for (int x = 0; x < width; x++) {
+		row.packed[x / 2] |= codes[(uint8_t)tiles[x]] << ((x & 1) * 4);
+	}
+}
+
+void CompressedMap::runLengthEncode(Row& row, const char* tiles) {
+	row.runs.clear();
+	for (int x = 1; x <= width; x++) {
+		if (x == width || tiles[x] != tiles[x - 1]) {
+			row.runs.push_back((uint32_t)x << 4 | codes[(uint8_t)tiles[x - 1]]);
+		}
+	}
+	row.runs.shrink_to_fit();
+}
+
+uint8_t CompressedMap::codeAt(const Row& row, int x) const {
+	if (row.runs.empty()) {
+		return (row.packed[x / 2] >> ((x & 1) * 4)) & 0xf;
+	}
+	// first run that ends after x
+	auto run = std::upper_bound(row.runs.begin(), row.runs.end(), (uint32_t)x << 4 | 0xf);
+	return *run & 0xf;
+}
@@ -0,0 +1,69 @@
+#ifndef COMPRESSEDMAP_HPP
+#define COMPRESSEDMAP_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "tileView.hpp"
+
+// Compressed resident copy of a tile grid. Tiles are stored as 4 bit codes
+// into a palette of at most 16 distinct tile values (Generation only has six).
+// Every row is either
+//   - packed: two tiles per byte, O(1) random access, for hot rows
+//   - run length encoded: for cold rows, which are mostly long Tile_Empty
+//     or Tile_Wall runs, O(log runs) random access
+class CompressedMap {
+public:
+	static constexpr int PaletteSize = 16;
+
+	CompressedMap() = default;
+	CompressedMap(const TileView& tiles);
+
+	// Throws std::runtime_error if the grid has more than PaletteSize distinct tiles.
+	// Rows start out in whichever encoding is smaller.
+	void Compress(const TileView& tiles);
+
+	char At(int x, int y) const;
+	// Turns the row hot if it's run length encoded
+	void Set(int x, int y, char tile);
+
+	// Writes `count` tiles of row y starting at column x to out
+	void DecompressRow(int y, int x, int count, char* out) const;
+	inline void DecompressRow(int y, char* out) const { DecompressRow(y, 0, width, out); }
+
+	// Hot rows are kept packed for fast lookups, cold rows get run length
+	// encoded again if that's smaller
+	void MakeHot(int firstRow, int lastRow);
+	void MakeCold(int firstRow, int lastRow);
+	inline bool IsHot(int y) const { return rows[y].runs.empty(); }
+
+	inline int GetWidth() const { return width; }
+	inline int GetHeight() const { return height; }
+	// bytes used for the tile data, without the fixed per row overhead
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Row {
+		// two codes per byte, low nibble first; empty if the row is run length encoded
+		std::vector<uint8_t> packed;
+		// (end column << 4 | code) of every run, the end column is exclusive
+		std::vector<uint32_t> runs;
+	};
+
+	int width{0};
+	int height{0};
+	int paletteCount{0};
+	std::array<char, PaletteSize> palette{};
+	std::array<int8_t, 256> codes{};
+	// decoded pair of tiles for every possible packed byte
+	std::array<std::array<char, 2>, 256> pairs{};
+	std::vector<Row> rows;
+
+	uint8_t encode(char tile);
+	void pack(Row& row, const char* tiles);
+	void runLengthEncode(Row& row, const char* tiles);
+	uint8_t codeAt(const Row& row, int x) const;
+};
+
+#endif /* COMPRESSEDMAP_HPP */
@@ -1,91 +1,530 @@
 #include "display.hpp"
+#include "profiler.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
-Display::Display(int width, int height, const std::string& title, bool resizeable, bool vsync, float xScale, float yScale) : width(width), height(height), title(title), xScale(xScale), yScale(yScale) {
-    if(!SDL_WasInit(SDL_INIT_EVERYTHING)) {
-        isInit = false;
-        return;
+Display::Display(int width, int height, const std::string& title, bool resizeable, bool vsync, float xScale, float yScale, Backend backend) : backend(backend), width(width), height(height), title(title), vsync(vsync), xScale(xScale), yScale(yScale) {
+    if(backend == Backend::Window) {
+        if(!SDL_WasInit(SDL_INIT_EVERYTHING)) {
+            isInit = false;
+            return;
+        }
+        
+        window = SDL_CreateWindow(title.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width*xScale, height*yScale, SDL_WINDOW_ALLOW_HIGHDPI | (resizeable * SDL_WINDOW_RESIZABLE));
+        
+        createRenderer();
     }
     
-    window = SDL_CreateWindow(title.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width*xScale, height*yScale, SDL_WINDOW_ALLOW_HIGHDPI | (resizeable * SDL_WINDOW_RESIZABLE));
+    buffers[0].Resize(width, height);
+    pixels = buffers[0].GetPixels();
+    pitch = buffers[0].GetPitch();
+    updateTextureSize();
+    publish();
     
+    isClosed = false;
+    isInit = true;
+}
+
+Display::~Display() {
+    if (threaded) {
+        stopPresenterThread();
+    }
+    unlockTexture();
+    destroyRenderer();
+    if (window) SDL_DestroyWindow(window);
+}
+
+void Display::createRenderer() {
 	uint32_t flags = vsync * SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_ACCELERATED;
     renderer = SDL_CreateRenderer(window, -1, flags);
-    
+}
+
+void Display::createTexture(int width, int height) {
+    if (texture) SDL_DestroyTexture(texture);
     texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR32, SDL_TEXTUREACCESS_STREAMING, width, height);
     SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+}
+
+void Display::destroyRenderer() {
+    if (texture) SDL_DestroyTexture(texture);
+    if (renderer) SDL_DestroyRenderer(renderer);
+    texture = nullptr;
+    renderer = nullptr;
+    textureWidth = 0;
+    textureHeight = 0;
+}
+
+// recreates the texture if the capacity of the buffers changed
+void Display::updateTextureSize() {
+    if (!renderer || threaded) return;
+    int capacityWidth = buffers[0].GetCapacityWidth();
+    int capacityHeight = buffers[0].GetCapacityHeight();
+    if (capacityWidth == textureWidth && capacityHeight == textureHeight) return;
     
-    this->pixels = new uint32_t[width * height];
-    memset(pixels, 0, width*height*sizeof(uint32_t));
+    createTexture(capacityWidth, capacityHeight);
+    allDirty = true;
+    textureWidth = capacityWidth;
+    textureHeight = capacityHeight;
+}
+
+// the buffers keep their capacity, so the buffers and the texture are only
+// reallocated when the window gets bigger than it ever was
+void Display::resizeBuffers(int width, int height) {
+    this->width = width;
+    this->height = height;
+    allDirty = true;
     
-//    int pitch = 0;
-//    SDL_LockTexture(texture, nullptr, (void**)&this->pixels, &pitch);
+    if (threaded) {
+        // only the ring is drawn to, the presenter recreates its texture when it sees the new capacity
+        for (auto& slot : ring)
+            slot.Resize(width, height);
+        pixels = ring[drawSlot].GetPixels();
+        pitch = ring[drawSlot].GetPitch();
+        return;
+    }
+    for (auto& buffer : buffers) {
+        if (buffer.GetPixels()) buffer.Resize(width, height);
+    }
+    pixels = buffers[current].GetPixels();
+    pitch = buffers[current].GetPitch();
+    updateTextureSize();
+}
+
+void Display::shrinkBuffers() {
+    // NOTE: all buffers went through the same resizes, so they all shrink or none does
+    if (threaded) {
+        for (auto& slot : ring)
+            slot.ShrinkToFit();
+        pixels = ring[drawSlot].GetPixels();
+        pitch = ring[drawSlot].GetPitch();
+        return;
+    }
+    for (auto& buffer : buffers) {
+        if (buffer.GetPixels()) buffer.ShrinkToFit();
+    }
+    pixels = buffers[current].GetPixels();
+    pitch = buffers[current].GetPitch();
+    updateTextureSize();
+}
+
+void Display::SetDirtyTracking(bool enable) {
+    dirtyTracking = enable;
+    MarkAllDirty();
+}
+
+void Display::AddDirtyRect(int x, int y, int width, int height) {
+    if (!dirtyTracking || allDirty) return;
+    int x1 = std::max(x, 0);
+    int y1 = std::max(y, 0);
+    int x2 = std::min(x + width, this->width);
+    int y2 = std::min(y + height, this->height);
+    if (x1 >= x2 || y1 >= y2) return;
+    dirtyRects.push_back(SDL_Rect{x1, y1, x2 - x1, y2 - y1});
+}
+
+void Display::MarkAllDirty() {
+    allDirty = true;
+    dirtyRects.clear();
+}
+
+// Merges the dirty rectangles of this frame into rects, returns true if everything has to be uploaded
+bool Display::takeDirtyRects(std::vector<SDL_Rect>& rects) {
+    rects.clear();
+    // NOTE: with more than one buffer the pixels outside this frame's damage are from an older frame
+    bool swapsBuffers = threaded || (streaming && buffers[1].GetPixels());
+    bool fullUpload = !dirtyTracking || allDirty || swapsBuffers;
+    allDirty = false;
+    if (fullUpload) {
+        dirtyRects.clear();
+        return true;
+    }
     
+    auto touches = [](const SDL_Rect& a, const SDL_Rect& b) {
+        return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+    };
+    auto merge = [](SDL_Rect& a, const SDL_Rect& b) {
+        int x2 = std::max(a.x + a.w, b.x + b.w);
+        int y2 = std::max(a.y + a.h, b.y + b.h);
+        a.x = std::min(a.x, b.x);
+        a.y = std::min(a.y, b.y);
+        a.w = x2 - a.x;
+        a.h = y2 - a.y;
+    };
+    for (const SDL_Rect& dirty : dirtyRects) {
+        SDL_Rect rect = dirty;
+        // a merged rectangle can touch ones it didn't touch before, so keep going until nothing changes
+        for (bool merged = true; merged;) {
+            merged = false;
+            for (size_t i = 0; i < rects.size(); i++) {
+                if (touches(rect, rects[i])) {
+                    merge(rect, rects[i]);
+                    rects[i] = rects.back();
+                    rects.pop_back();
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        rects.push_back(rect);
+    }
+    dirtyRects.clear();
     
-    isClosed = false;
-    isInit = true;
+    if (rects.size() > MaxDirtyRects) {
+        for (size_t i = 1; i < rects.size(); i++)
+            merge(rects[0], rects[i]);
+        rects.resize(1);
+    }
+    uint64_t area = 0;
+    for (const SDL_Rect& rect : rects)
+        area += (uint64_t)rect.w * rect.h;
+    return area > DirtyCoverageThreshold * width * height;
 }
 
-Display::~Display() {
-    SDL_DestroyTexture(texture);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    delete[] pixels;
+uint64_t Display::uploadFrame(const uint32_t* pixels, int width, int height, int pitch, bool fullUpload, const std::vector<SDL_Rect>& rects) {
+    PROFILE_ZONE("upload");
+    if (fullUpload) {
+        SDL_Rect rect{0,0, width, height};
+        SDL_UpdateTexture(texture, &rect, pixels, pitch * sizeof(uint32_t));
+        return (uint64_t)width * height;
+    }
+    uint64_t uploaded = 0;
+    for (const SDL_Rect& rect : rects) {
+        SDL_UpdateTexture(texture, &rect, pixels + rect.x + rect.y * pitch, pitch * sizeof(uint32_t));
+        uploaded += (uint64_t)rect.w * rect.h;
+    }
+    return uploaded;
+}
+
+int Display::AddFramebufferListener(FramebufferListener listener) {
+    listener(pixels, width, height, pitch);
+    listeners.emplace_back(nextListenerId, std::move(listener));
+    return nextListenerId++;
+}
+
+void Display::RemoveFramebufferListener(int id) {
+    listeners.erase(std::remove_if(listeners.begin(), listeners.end(), [&](const auto& l) { return l.first == id; }), listeners.end());
+}
+
+void Display::publish() {
+    if (pixels == publishedPixels && width == publishedWidth && height == publishedHeight && pitch == publishedPitch) return;
+    
+    publishedPixels = pixels;
+    publishedWidth = width;
+    publishedHeight = height;
+    publishedPitch = pitch;
+    framebufferGeneration++;
+    for (auto& listener : listeners)
+        listener.second(pixels, width, height, pitch);
 }
 
+void Display::SetThreadedPresent(bool enable) {
+    if (enable == threaded || backend == Backend::Headless) return;
+    
+    if (enable) {
+        SetStreaming(false);
+        // the renderer belongs to the presenter thread from now on
+        destroyRenderer();
+        MarkAllDirty();
+        
+        for (int i = 0; i < RingSize; i++) {
+            ring[i].Reserve(buffers[0].GetCapacityWidth(), buffers[0].GetCapacityHeight());
+            ring[i].CopyFrom(buffers[0]);
+            ringState[i] = SlotState::Free;
+        }
+        // only the ring is drawn to from now on
+        for (auto& buffer : buffers)
+            buffer = Framebuffer();
+        drawSlot = 0;
+        ringState[drawSlot] = SlotState::Drawing;
+        pixels = ring[drawSlot].GetPixels();
+        pitch = ring[drawSlot].GetPitch();
+        
+        stopPresenter = false;
+        threaded = true;
+        presenter = std::thread(&Display::presentLoop, this);
+    } else {
+        stopPresenterThread();
+        
+        buffers[0].Reserve(ring[drawSlot].GetCapacityWidth(), ring[drawSlot].GetCapacityHeight());
+        buffers[0].CopyFrom(ring[drawSlot]);
+        for (auto& slot : ring)
+            slot = Framebuffer();
+        queuedFrames.clear();
+        pixels = buffers[0].GetPixels();
+        pitch = buffers[0].GetPitch();
+        createRenderer();
+        updateTextureSize();
+        MarkAllDirty();
+    }
+    publish();
+}
+
+void Display::stopPresenterThread() {
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        stopPresenter = true;
+    }
+    ringCondition.notify_all();
+    presenter.join();
+    threaded = false;
+}
+
+void Display::presentLoop() {
+    Profiler::SetThreadName("presenter");
+    createRenderer();
+    // the texture gets created for the first frame, it's as big as the capacity of the ring buffers
+    int presenterTextureWidth = 0;
+    int presenterTextureHeight = 0;
+    
+    while (true) {
+        QueuedFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(ringMutex);
+            ringCondition.wait(lock, [&]{ return stopPresenter || !queuedFrames.empty(); });
+            // the queued frames still get presented when stopping
+            if (queuedFrames.empty()) break;
+            frame = std::move(queuedFrames.front());
+            queuedFrames.pop_front();
+            ringState[frame.slot] = SlotState::Presenting;
+        }
+        PROFILE_ZONE("present");
+        
+        if (frame.pitch != presenterTextureWidth || frame.capacityHeight != presenterTextureHeight) {
+            createTexture(frame.pitch, frame.capacityHeight);
+            presenterTextureWidth = frame.pitch;
+            presenterTextureHeight = frame.capacityHeight;
+            frame.fullUpload = true;
+        }
+        
+        uploadedPixels = uploadFrame(ring[frame.slot].GetPixels(), frame.width, frame.height, frame.pitch, frame.fullUpload, frame.dirtyRects);
+        SDL_RenderClear(renderer);
+        SDL_Rect srcRect{0,0, frame.width, frame.height};
+        SDL_RenderCopy(renderer, texture, &srcRect, &frame.dstRect);
+        SDL_RenderPresent(renderer);
+        
+        {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            ringState[frame.slot] = SlotState::Free;
+        }
+        ringCondition.notify_all();
+    }
+    
+    destroyRenderer();
+}
+
+void Display::submitFrame() {
+    PROFILE_FUNCTION();
+    QueuedFrame frame;
+    frame.slot = drawSlot;
+    frame.width = width;
+    frame.height = height;
+    frame.pitch = ring[drawSlot].GetPitch();
+    frame.capacityHeight = ring[drawSlot].GetCapacityHeight();
+    frame.fullUpload = takeDirtyRects(frame.dirtyRects);
+    frame.dstRect = presentRect();
+    
+    std::unique_lock<std::mutex> lock(ringMutex);
+    ringState[drawSlot] = SlotState::Queued;
+    queuedFrames.push_back(std::move(frame));
+    ringCondition.notify_all();
+    
+    // backpressure: wait for the presenter to free up a buffer
+    auto freeSlot = [&]{
+        for (int i = 0; i < RingSize; i++)
+            if (ringState[i] == SlotState::Free) return i;
+        return -1;
+    };
+    ringCondition.wait(lock, [&]{ return freeSlot() != -1; });
+    drawSlot = freeSlot();
+    ringState[drawSlot] = SlotState::Drawing;
+    pixels = ring[drawSlot].GetPixels();
+    pitch = ring[drawSlot].GetPitch();
+}
+
+// waits until the presenter doesn't touch any buffer anymore
+void Display::waitForPresenter() {
+    std::unique_lock<std::mutex> lock(ringMutex);
+    ringCondition.wait(lock, [&]{
+        for (int i = 0; i < RingSize; i++)
+            if (ringState[i] == SlotState::Queued || ringState[i] == SlotState::Presenting) return false;
+        return true;
+    });
+}
+
+bool Display::SetStreaming(bool enable) {
+    if (threaded || backend == Backend::Headless) return false;
+    streaming = enable;
+    MarkAllDirty();
+    if (!enable) {
+        unlockTexture();
+        current = 0;
+        pixels = buffers[0].GetPixels();
+        pitch = buffers[0].GetPitch();
+        publish();
+        return false;
+    }
+    
+    bool isLocked = lockTexture();
+    if (!isLocked && !buffers[1].GetPixels()) {
+        // same capacity as the first buffer, so both fit the texture
+        buffers[1].Reserve(buffers[0].GetCapacityWidth(), buffers[0].GetCapacityHeight());
+        buffers[1].Resize(width, height);
+    }
+    publish();
+    return isLocked;
+}
+
+bool Display::lockTexture() {
+    if (locked) return true;
+    if (!canLock) return false;
+    
+    void* data = nullptr;
+    int bytes = 0;
+    // the texture can be bigger than the canvas
+    SDL_Rect rect{0,0, width, height};
+    if (SDL_LockTexture(texture, &rect, &data, &bytes) != 0) {
+        std::cerr << "Can't lock the texture, falling back to double buffering: " << SDL_GetError() << std::endl;
+        canLock = false;
+        return false;
+    }
+    pixels = static_cast<uint32_t*>(data);
+    pitch = bytes / sizeof(uint32_t);
+    locked = true;
+    return true;
+}
+
+// keepFrame copies what was drawn into the texture to the buffer, for when the texture might get recreated
+void Display::unlockTexture(bool keepFrame) {
+    if (!locked) return;
+    if (keepFrame) {
+        uint32_t* buffer = buffers[current].GetPixels();
+        for (int y = 0; y < height; y++)
+            memcpy(buffer + y * buffers[current].GetPitch(), pixels + y * pitch, width * sizeof(uint32_t));
+    }
+    SDL_UnlockTexture(texture);
+    locked = false;
+    pixels = buffers[current].GetPixels();
+    pitch = buffers[current].GetPitch();
+}
+
+
+bool Display::DumpFrames(const std::string& path, DumpFormat format, double frameRate) {
+    FrameCapture::Overflow overflow = backend == Backend::Headless ? FrameCapture::Overflow::Wait : FrameCapture::Overflow::Drop;
+    return capture.Start(path, format, overflow, frameRate);
+}
+
+void Display::StopDumping() {
+    capture.Stop();
+}
 
 void Display::Update() {
+	PROFILE_ZONE("Display::Update");
 	resized = false;
     EventHandler::Update();
     if (EventHandler::GetEvents(SDL_QUIT).size() > 0) {
         isClosed = true;
     }
+    // NOTE: the finished frame, before it's handed to the texture or the presenter
+    if (capture.IsCapturing()) {
+        capture.Submit(cdr::BitmapView{pixels, width, height, pitch}, frameCount);
+    }
+	
+	if (backend == Backend::Headless) {
+		dirtyRects.clear();
+		frameCount++;
+		publish();
+		return;
+	}
+	frameCount++;
 	
 	if (auto e = EventHandler::GetEvents(SDL_WINDOWEVENT); e.size() > 0) {
-		for (const auto& ev : e) {
-			const SDL_Event& event = ev.get();
+		// dragging a window edge sends lots of resizes, only the last one matters
+		const SDL_Event* lastResizeEvent = nullptr;
+		for (const SDL_Event& event : e) {
 			if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
-				resized = true;
-				
-				width = event.window.data1;
-				height = event.window.data2;
-				
-				uint32_t* newPixels = new uint32_t[width * height];
-				memcpy(newPixels, pixels, width * sizeof(uint32_t));
-				delete[] pixels;
-				pixels = newPixels;
-				
-				SDL_DestroyTexture(texture);
-				texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR32, SDL_TEXTUREACCESS_STREAMING, width, height);
-    			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
-				break;
+				lastResizeEvent = &event;
 			}
 		}
+		if (lastResizeEvent) {
+			pendingWidth = lastResizeEvent->window.data1;
+			pendingHeight = lastResizeEvent->window.data2;
+			lastResize = SDL_GetTicks();
+			// dragging back to the current size doesn't need a resize anymore
+			resizePending = pendingWidth != width || pendingHeight != height;
+		}
+	}
+	// NOTE: buffers and textures are only reallocated once the size settled, in either direction
+	if (resizePending && SDL_GetTicks() - lastResize >= ResizeDelay) {
+		resizePending = false;
+		resized = true;
+		unlockTexture(true);
+		if (threaded) waitForPresenter();
+		// what was drawn at the old size is kept, so this frame is still presented
+		resizeBuffers(pendingWidth, pendingHeight);
+		shrinkBuffers();
 	}
-	
 
-    SDL_UpdateTexture(texture, NULL, pixels, width * sizeof(uint32_t));
+	if (threaded) {
+		submitFrame();
+		publish();
+		return;
+	}
+	
+	if (locked) {
+		// the frame is already in the texture
+		unlockTexture();
+		dirtyRects.clear();
+		allDirty = false;
+		uploadedPixels = 0;
+	} else {
+		bool fullUpload = takeDirtyRects(uploadRects);
+		uploadedPixels = uploadFrame(pixels, width, height, pitch, fullUpload, uploadRects);
+		if (streaming && buffers[1].GetPixels()) {
+			// double buffering because the texture can't be locked
+			current = !current;
+			pixels = buffers[current].GetPixels();
+			pitch = buffers[current].GetPitch();
+		}
+	}
 	
+	PROFILE_ZONE("present");
     SDL_RenderClear(renderer);
 	
 	SDL_Rect srcRect{0,0, GetCanvasWidth(), GetCanvasHeight()};
-	SDL_Rect dstRect{0,0, GetWindowWidth(), GetWindowHeight()};
+	SDL_Rect dstRect = presentRect();
     SDL_RenderCopy(renderer, texture, &srcRect, &dstRect);
     SDL_RenderPresent(renderer);
+	
+	if (streaming) {
+		lockTexture();
+	}
+	publish();
+}
+
+// Where the canvas goes in the window. While a resize is pending the canvas keeps its
+// size and is scaled to fit the new window, centred with black bars around it.
+SDL_Rect Display::presentRect() const {
+    if (!resizePending) return SDL_Rect{0,0, GetWindowWidth(), GetWindowHeight()};
+    
+    float scale = std::min(pendingWidth / (width * xScale), pendingHeight / (height * yScale));
+    int w = width * xScale * scale;
+    int h = height * yScale * scale;
+    return SDL_Rect{(pendingWidth - w) / 2, (pendingHeight - h) / 2, w, h};
 }
 
 void Display::Clear() {
-    memset(this->pixels, 0, width * height * sizeof(uint32_t));
+    for (int y = 0; y < height; y++)
+        memset(this->pixels + y * pitch, 0, width * sizeof(uint32_t));
 }
 void Display::Clear(cdr::RGB color) {
-    for (int i = 0; i < width*height; i++)
-        pixels[i] = cdr::RGBtoUINT(color);
+    for (int y = 0; y < height; y++)
+        std::fill_n(pixels + y * pitch, width, cdr::RGBtoUINT(color));
 }
 void Display::Clear(cdr::RGBA color) {
-    for (int i = 0; i < width*height; i++)
-        pixels[i] = cdr::RGBtoUINT(color);
+    for (int y = 0; y < height; y++)
+        std::fill_n(pixels + y * pitch, width, cdr::RGBtoUINT(color));
 }
 
 void Display::Abort() {
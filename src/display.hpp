@@ -7,13 +7,31 @@
 # include <SDL.h>
 #endif
 #include <string>   
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "eventHandler.hpp"
+#include "frameCapture.hpp"
+#include "framebuffer.hpp"
 #include "cidr.hpp"
 
 // A wraper for SDL_Window and some other stuff
 class Display {
 public:
-    Display(int width, int height, const std::string& title, bool resizeable = false, bool vsync = false, float xScale = 1.0f, float yScale = 1.0f);
+    enum class Backend {
+        Window,   // SDL window, renderer and texture
+        Headless, // just the pixel buffer, doesn't need SDL video (frames can be dumped instead)
+    };
+    using DumpFormat = FrameCapture::Format;
+    
+    // Called with the new pixels, width, height and pitch whenever the buffer that's drawn to changes
+    using FramebufferListener = std::function<void(uint32_t* pixels, int width, int height, int pitch)>;
+    
+    Display(int width, int height, const std::string& title, bool resizeable = false, bool vsync = false, float xScale = 1.0f, float yScale = 1.0f, Backend backend = Backend::Window);
     
     void Update();
     void Clear();
@@ -21,12 +39,67 @@ public:
     void Clear(cdr::RGBA color);
     void Abort();
     
+    // In streaming mode the frame is rendered straight into the locked texture, which saves
+    // copying it on every Update(). GetPixels() and GetPitch() can change with every Update()
+    // then, so renderers have to be rebound each frame, and a new frame starts out undefined.
+    // If the texture can't be locked, two buffers are used instead that swap after each upload.
+    // Only a win for frames that are written once and never read back: locked texture memory
+    // is usually write combined, so blending or dumping frames gets a lot slower.
+    // Returns whether the texture could be locked.
+    bool SetStreaming(bool enable);
+    
+    // Hands finished frames to a presenter thread that uploads and presents them, so the next
+    // frame can be rendered in the meantime. Frames go through a ring of RingSize buffers:
+    // one is drawn to, the others are queued or being presented. Update() blocks while all
+    // of them are in use, so the presenter is never more than RingSize - 1 frames behind.
+    // Like in streaming mode GetPixels() changes with every Update() and a new frame starts
+    // out undefined. Events are still pumped by Update() on the calling thread.
+    // NOTE: the presenter thread creates its own SDL_Renderer, streaming is turned off
+    void SetThreadedPresent(bool enable);
+    
+    // Writes every frame on Update(), see FrameCapture::Start() for the formats. The frames are
+    // copied and encoded on another thread. With a window, frames are dropped instead of waiting
+    // when the encoder falls behind, headless frames are all written since nobody watches them.
+    // Returns false if the stream can't be opened.
+    bool DumpFrames(const std::string& path, DumpFormat format, double frameRate = 60);
+    // Writes the frames that are still queued and stops dumping
+    void StopDumping();
+    
+    // Renderers and everything else that draws into GetPixels() should register here instead of
+    // asking for the pixels every frame. The listener is called right away and then after every
+    // Update(), SetStreaming() or SetThreadedPresent() that changed the pixels, size or pitch.
+    // Returns an id for RemoveFramebufferListener().
+    int AddFramebufferListener(FramebufferListener listener);
+    void RemoveFramebufferListener(int id);
+    
+    // With dirty tracking Update() only uploads the rectangles reported since the last Update(),
+    // the rest of the texture keeps what was uploaded before. Touching rectangles are merged and
+    // once they cover more than DirtyCoverageThreshold of the canvas the whole frame is uploaded.
+    // Resizes and mode changes always upload everything. Nothing is uploaded while streaming into
+    // the locked texture anyway.
+    // NOTE: presenting on another thread and double buffering always upload everything too, the
+    // buffer that's drawn to holds a frame that's a few frames old, which the damage doesn't cover.
+    // Only pays off for scenes that mostly stay the same, e.g. a renderer with damage tracking that
+    // doesn't clear the whole canvas every frame. The demo repaints everything.
+    void SetDirtyTracking(bool enable);
+    void AddDirtyRect(int x, int y, int width, int height);
+    void MarkAllDirty();
+    
+    static constexpr int RingSize = 3;
+    static constexpr float DirtyCoverageThreshold = 0.5f;
+    // more rectangles than that are merged into their bounding box
+    static constexpr size_t MaxDirtyRects = 32;
+    // A resize is only applied once the window size didn't change for this long, until then
+    // the last canvas size is kept and letterboxed into the window. Buffers and textures
+    // grow when it's applied and are shrunk if they are more than twice as big as needed.
+    static constexpr uint32_t ResizeDelay = 500; // ms
+    
     inline void SetPixel(int x, int y, cdr::RGBA color) {
-        this->pixels[x + y * this->width] = cdr::RGBtoUINT(color);
+        this->pixels[x + y * this->pitch] = cdr::RGBtoUINT(color);
     }
     inline void SetPixel(int x, int y, cdr::RGB color) {
         if(x >= 0 && y >= 0 && x < width && y < height)
-            this->pixels[x + y * this->width] = cdr::RGBtoUINT(color);
+            this->pixels[x + y * this->pitch] = cdr::RGBtoUINT(color);
     }
     inline bool IsInit() const {
         return isInit;
@@ -49,6 +122,37 @@ public:
     inline uint32_t* GetPixels() {
         return this->pixels;
     }
+    // distance between two rows of GetPixels() in pixels
+    inline int GetPitch() const {
+        return pitch;
+    }
+    inline bool IsStreaming() const {
+        return streaming;
+    }
+    inline bool IsThreadedPresent() const {
+        return threaded;
+    }
+    inline bool IsHeadless() const {
+        return backend == Backend::Headless;
+    }
+    // incremented whenever GetPixels(), the canvas size or GetPitch() changed
+    inline uint64_t GetFramebufferGeneration() const {
+        return framebufferGeneration;
+    }
+    inline bool IsDirtyTracking() const {
+        return dirtyTracking;
+    }
+    // pixels uploaded to the texture for the last frame
+    inline uint64_t GetUploadedPixels() const {
+        return uploadedPixels;
+    }
+    inline const FrameCapture& GetCapture() const {
+        return capture;
+    }
+    // number of Update() calls so far
+    inline uint64_t GetFrameCount() const {
+        return frameCount;
+    }
     inline bool IsClosed() const  {
         return isClosed;
     }
@@ -63,9 +167,11 @@ public:
     
 private:
     bool isInit;
+    Backend backend;
+    uint64_t frameCount = 0;
     
     // window fields
-    SDL_Window* window;
+    SDL_Window* window {nullptr};
     int width;
     int height;
     const std::string title;
@@ -73,11 +179,83 @@ private:
 	bool resized = false;
     
     // gfx fields
-    SDL_Renderer* renderer;
-    SDL_Texture* texture;
-    uint32_t* pixels;
+    SDL_Renderer* renderer {nullptr};
+    SDL_Texture* texture {nullptr};
+    uint32_t* pixels; // what's drawn to, either buffers[current] or the locked texture
+    int pitch;
+    Framebuffer buffers[2]; // the second one is only used by the streaming fallback, neither while threaded
+    int current = 0;
+    // the texture is as big as the capacity of the buffers, not the canvas
+    int textureWidth = 0;
+    int textureHeight = 0;
+    bool resizePending = false;
+    int pendingWidth = 0; // the window size while resizePending
+    int pendingHeight = 0;
+    uint32_t lastResize = 0;
+    bool streaming = false;
+    bool locked = false;
+    bool canLock = true;
+    bool vsync;
+    
+    // threaded presentation
+    enum class SlotState { Free, Drawing, Queued, Presenting };
+    struct QueuedFrame {
+        int slot = 0;
+        int width = 0;
+        int height = 0;
+        int pitch = 0;
+        int capacityHeight = 0;
+        bool fullUpload = true;
+        SDL_Rect dstRect{};
+        std::vector<SDL_Rect> dirtyRects;
+    };
+    bool threaded = false;
+    std::thread presenter;
+    std::mutex ringMutex;
+    std::condition_variable ringCondition;
+    Framebuffer ring[RingSize];
+    SlotState ringState[RingSize] {};
+    std::deque<QueuedFrame> queuedFrames;
+    int drawSlot = 0;
+    bool stopPresenter = false;
+    
+    // dirty rectangles
+    bool dirtyTracking = false;
+    bool allDirty = true;
+    std::vector<SDL_Rect> dirtyRects;
+    std::vector<SDL_Rect> uploadRects; // dirtyRects after merging
+    std::atomic<uint64_t> uploadedPixels {0};
+    
+    // framebuffer listeners
+    std::vector<std::pair<int, FramebufferListener>> listeners;
+    int nextListenerId = 0;
+    uint64_t framebufferGeneration = 0;
+    uint32_t* publishedPixels = nullptr;
+    int publishedWidth = 0;
+    int publishedHeight = 0;
+    int publishedPitch = 0;
+    
+    // frame dumps
+    FrameCapture capture;
 	float xScale;
 	float yScale;
+	
+	bool lockTexture();
+	void unlockTexture(bool keepFrame = false);
+	void createRenderer();
+	void createTexture(int width, int height);
+	void destroyRenderer();
+	void presentLoop();
+	void stopPresenterThread();
+	void submitFrame();
+	void waitForPresenter();
+	void resizeBuffers(int width, int height);
+	void shrinkBuffers();
+	void updateTextureSize();
+	SDL_Rect presentRect() const;
+	void publish();
+	bool takeDirtyRects(std::vector<SDL_Rect>& rects);
+	uint64_t uploadFrame(const uint32_t* pixels, int width, int height, int pitch, bool fullUpload, const std::vector<SDL_Rect>& rects);
 };
 
 
@@ -2,20 +2,142 @@
 
 #include <iostream>
 #include <cstring>
-#include <functional>
+#include <algorithm>
+#include <fstream>
+#include "timer.hpp"
+
+// Input log: a header, then per Update() the frame time, the keys that changed and the events.
+//   header: "BLIR", u32 version, u32 sizeof(SDL_Event), u32 SDL_NUM_SCANCODES, u64 seed
+//   frame:  f64 seconds, u16 changed keys, (u16 scancode, u8 state) * changed keys,
+//           u16 events, SDL_Event * events
+// NOTE: everything is written in the byte order of the machine that recorded it
+namespace {
+    constexpr char LogMagic[4] {'B', 'L', 'I', 'R'};
+    constexpr uint32_t LogVersion = 1;
+
+    std::ofstream recordFile;
+    std::ifstream replayFile;
+    bool recording = false;
+    bool replaying = false;
+    bool replayFinished = false;
+    uint64_t replaySeed = 0;
+    uint8_t recordedKeys[SDL_NUM_SCANCODES] {};
+    uint8_t replayKeys[SDL_NUM_SCANCODES] {};
+    uint8_t* sdlKeys = nullptr;
+    Timer frameTimer;
+    double frameSeconds = 0;
+    bool frameTimerStarted = false;
+
+    template<typename T>
+    void write(const T& value) {
+        recordFile.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    template<typename T>
+    bool read(T& value) {
+        return (bool)replayFile.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    // events with pointers in them can't be replayed
+    bool isRecordable(const SDL_Event& event) {
+        return event.type != SDL_DROPFILE && event.type != SDL_DROPTEXT && event.type < SDL_USEREVENT;
+    }
+
+    void writeFrame() {
+        write(frameSeconds);
+
+        uint16_t changed = 0;
+        for (int i = 0; i < SDL_NUM_SCANCODES; i++)
+            changed += recordedKeys[i] != EventHandler::_keys[i];
+        write(changed);
+        for (uint16_t i = 0; i < SDL_NUM_SCANCODES; i++) {
+            if (recordedKeys[i] == EventHandler::_keys[i]) continue;
+            recordedKeys[i] = EventHandler::_keys[i];
+            write(i);
+            write(recordedKeys[i]);
+        }
+
+        uint16_t count = std::count_if(EventHandler::_capturedEvents.begin(), EventHandler::_capturedEvents.end(), isRecordable);
+        write(count);
+        for (const SDL_Event& event : EventHandler::_capturedEvents) {
+            if (isRecordable(event)) write(event);
+        }
+    }
+
+    // returns false at the end of the log
+    bool readFrame() {
+        uint16_t changed = 0;
+        if (!read(frameSeconds) || !read(changed)) return false;
+        for (int i = 0; i < changed; i++) {
+            uint16_t key = 0;
+            uint8_t state = 0;
+            if (!read(key) || !read(state) || key >= SDL_NUM_SCANCODES) return false;
+            replayKeys[key] = state;
+        }
+
+        uint16_t count = 0;
+        if (!read(count)) return false;
+        for (int i = 0; i < count; i++) {
+            SDL_Event event;
+            if (!read(event)) return false;
+            EventHandler::_capturedEvents.push_back(event);
+        }
+        return true;
+    }
+}
 
 // NOTE: if the framerate is very low and the user calls IsLeftMouseDown() (or any other mouse button function) it may return a wrong answer, because the update method went through the mouse down and mouse up event in one go (because the framerate is very low)
 void EventHandler::Update() {
     _mouseXRel = 0;
     _mouseYRel = 0;
     
-    for(int i = 0; i < SDL_NUM_SCANCODES; i++) {
-        _prevKeys[i] = _keys[i];
-    }
+    memcpy(_prevKeys, _keys, SDL_NUM_SCANCODES);
 	_capturedEvents.clear();
+	for (auto& bucket : _buckets) {
+		bucket.events.clear();
+	}
+	
+	if (frameTimerStarted) frameSeconds = frameTimer.elapsedSeconds();
+	frameTimer.reset();
+	frameTimerStarted = true;
+	
+	if (replaying) {
+		if (!replayFinished && !readFrame()) {
+			replayFinished = true;
+			_capturedEvents.clear();
+		}
+		// the session ends with the log, the window can still be closed
+		while (SDL_PollEvent(&_event)) {
+			if (_event.type == SDL_QUIT) {
+				_capturedEvents.push_back(_event);
+			}
+		}
+		if (replayFinished) {
+			SDL_Event quit{};
+			quit.type = SDL_QUIT;
+			_capturedEvents.push_back(quit);
+		}
+	} else {
+		while (SDL_PollEvent(&_event)) {
+			_capturedEvents.push_back(_event);
+		}
+	}
+	if (recording) writeFrame();
+	
+	EventBucket* bucket{nullptr};
 	int index{-1};
-    while (SDL_PollEvent(&_event)) {
-        _capturedEvents.push_back(_event);
+    for (const SDL_Event& event : _capturedEvents) {
+        _event = event;
+
+		// events of the same type usually come in bursts
+		if (!bucket || bucket->type != _event.type) {
+			auto it = std::find_if(_buckets.begin(), _buckets.end(), [](const EventBucket& b) { return b.type == _event.type; });
+			if (it == _buckets.end()) {
+				_buckets.push_back(EventBucket{_event.type, {}});
+				it = _buckets.end() - 1;
+			}
+			bucket = &*it;
+		}
+		bucket->events.push_back(_event);
 
 		if (_event.type == SDL_WINDOWEVENT)
 		{
@@ -84,13 +206,82 @@ void EventHandler::Update() {
     // }
 }
 
-std::vector<std::reference_wrapper<const SDL_Event>> EventHandler::GetEvents(uint32_t eventType) {
-	std::vector<std::reference_wrapper<const SDL_Event>> events;
-	for (const auto& event : _capturedEvents) {
-        if(event.type == eventType) {
-            events.push_back(std::cref(event));
+bool EventHandler::StartRecording(const std::string& path, uint64_t seed) {
+	StopRecording();
+	recordFile.open(path, std::ios::binary | std::ios::trunc);
+	if (!recordFile) return false;
+	
+	recordFile.write(LogMagic, sizeof(LogMagic));
+	write(LogVersion);
+	write((uint32_t)sizeof(SDL_Event));
+	write((uint32_t)SDL_NUM_SCANCODES);
+	write(seed);
+	// the first frame stores all keys that are down
+	memset(recordedKeys, 0, sizeof(recordedKeys));
+	recording = true;
+	return true;
+}
+
+void EventHandler::StopRecording() {
+	if (!recording) return;
+	recording = false;
+	recordFile.close();
+}
+
+bool EventHandler::StartReplay(const std::string& path) {
+	StopReplay();
+	replayFile.open(path, std::ios::binary);
+	
+	char magic[4] {};
+	uint32_t version = 0, eventSize = 0, scancodes = 0;
+	replayFile.read(magic, sizeof(magic));
+	if (!read(version) || !read(eventSize) || !read(scancodes) || !read(replaySeed)
+		|| memcmp(magic, LogMagic, sizeof(magic)) != 0 || version != LogVersion
+		|| eventSize != sizeof(SDL_Event) || scancodes != SDL_NUM_SCANCODES) {
+		replayFile.close();
+		return false;
+	}
+	
+	memset(replayKeys, 0, sizeof(replayKeys));
+	sdlKeys = _keys;
+	_keys = replayKeys;
+	replaying = true;
+	replayFinished = false;
+	return true;
+}
+
+void EventHandler::StopReplay() {
+	if (!replaying) return;
+	replaying = false;
+	_keys = sdlKeys;
+	replayFile.close();
+}
+
+bool EventHandler::IsRecording() {
+	return recording;
+}
+
+bool EventHandler::IsReplaying() {
+	return replaying;
+}
+
+bool EventHandler::IsReplayFinished() {
+	return replayFinished;
+}
+
+uint64_t EventHandler::GetReplaySeed() {
+	return replaySeed;
+}
+
+double EventHandler::GetFrameSeconds() {
+	return frameSeconds;
+}
+
+EventHandler::EventSpan EventHandler::GetEvents(uint32_t eventType) {
+	for (const auto& bucket : _buckets) {
+		if (bucket.type == eventType) {
+			return EventSpan{bucket.events.data(), bucket.events.size()};
 		}
-    }
-    
-    return events;
+	}
+	return EventSpan{};
 }
@@ -7,9 +7,27 @@
 # include <SDL.h>
 #endif
 
+#include <string>
 #include <vector>
 
 namespace EventHandler {
+    // A view of the events of one type, valid until the next Update()
+    struct EventSpan {
+        const SDL_Event* data{nullptr};
+        size_t count{0};
+        
+        inline const SDL_Event* begin() const { return data; }
+        inline const SDL_Event* end() const { return data + count; }
+        inline size_t size() const { return count; }
+        inline bool empty() const { return count == 0; }
+        inline const SDL_Event& operator[](size_t i) const { return data[i]; }
+    };
+    // events of one type, buckets are only cleared so their memory gets reused every frame
+    struct EventBucket {
+        uint32_t type;
+        std::vector<SDL_Event> events;
+    };
+    
     inline SDL_Event _event{};
     // input fields
     inline uint8_t _prevKeys[SDL_NUM_SCANCODES] { 0 };
@@ -26,7 +44,8 @@ namespace EventHandler {
     inline int _isLeftMouseDown{};
     inline int _isRightMouseDown{};
     inline int _isMiddleMouseDown{};
-    inline std::vector<SDL_Event> _capturedEvents(32);
+    inline std::vector<SDL_Event> _capturedEvents;
+    inline std::vector<EventBucket> _buckets;
 	
     void Update();
     
@@ -66,7 +85,23 @@ namespace EventHandler {
     //bool IsMiddleMouseDown();
 	
 	inline const std::vector<SDL_Event>& GetAllEvents() { return _capturedEvents; }
-    std::vector<std::reference_wrapper<const SDL_Event>> GetEvents(uint32_t eventType);
+    EventSpan GetEvents(uint32_t eventType);
+    
+    // Input recording: every Update() appends the events, the changed keys and the time since the
+    // last Update() to a binary log. A replay feeds them back one Update() at a time instead of
+    // polling SDL (only SDL_QUIT still gets through) and ends with an SDL_QUIT. The seed is stored
+    // in the log, so the random numbers can be replayed too.
+    // NOTE: drop and user events aren't recorded
+    bool StartRecording(const std::string& path, uint64_t seed = 0);
+    void StopRecording();
+    bool StartReplay(const std::string& path);
+    void StopReplay();
+    bool IsRecording();
+    bool IsReplaying();
+    bool IsReplayFinished();
+    uint64_t GetReplaySeed();
+    // time between the last two Update() calls, or the recorded one while replaying
+    double GetFrameSeconds();
 };
 
 
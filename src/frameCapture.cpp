@@ -0,0 +1,199 @@
+#include "frameCapture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "profiler.hpp"
+
+FrameCapture::~FrameCapture() {
+	Stop();
+}
+
+bool FrameCapture::Start(const std::string& path, Format format, Overflow overflow, double frameRate, int ringSize) {
+	Stop();
+	this->path = path;
+	this->format = format;
+	this->overflow = overflow;
+	this->frameRate = frameRate > 0 ? frameRate : 60;
+	streamWidth = 0;
+	streamHeight = 0;
+	stats = {};
+	error.clear();
+
+	out = nullptr;
+	if (format == Format::Raw || format == Format::Y4M) {
+		if (path == "-") {
+			out = &std::cout;
+		} else {
+			file.open(path, std::ios::binary | std::ios::trunc);
+			if (!file) return false;
+			out = &file;
+		}
+	}
+
+	slots = std::vector<Slot>(std::max(ringSize, 1));
+	freeSlots.clear();
+	queue.clear();
+	for (int i = 0; i < (int)slots.size(); i++) freeSlots.push_back(i);
+	stopping = false;
+	capturing = true;
+	encoder = std::thread(&FrameCapture::encodeLoop, this);
+	return true;
+}
+
+void FrameCapture::Stop() {
+	if (!capturing) return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+	encoder.join();
+	if (out) out->flush();
+	file.close();
+	out = nullptr;
+	// NOTE: gives the bitmaps back to the pool
+	slots.clear();
+	capturing = false;
+}
+
+bool FrameCapture::Submit(const cdr::BitmapView& frame, uint64_t number) {
+	if (!capturing) return false;
+	PROFILE_ZONE("FrameCapture::Submit");
+	int index;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stats.submitted++;
+		if (freeSlots.empty()) {
+			if (overflow == Overflow::Drop) {
+				stats.dropped++;
+				return false;
+			}
+			freeCondition.wait(lock, [&]{ return !freeSlots.empty(); });
+		}
+		index = freeSlots.front();
+		freeSlots.pop_front();
+	}
+
+	// NOTE: the slot belongs to this thread until it's queued
+	Slot& slot = slots[index];
+	if (slot.frame.GetWidth() != frame.GetWidth() || slot.frame.GetHeight() != frame.GetHeight()) {
+		slot.frame = cdr::RGBABitmap(frame.GetWidth(), frame.GetHeight(), cdr::BitmapInit::None, cdr::BaseBitmap::AlignedPitch(frame.GetWidth()));
+	}
+	for (int y = 0; y < frame.GetHeight(); y++) {
+		memcpy(slot.frame.GetData() + (size_t)y * slot.frame.GetPitch(), frame.GetData() + (size_t)y * frame.GetPitch(), frame.GetWidth() * sizeof(uint32_t));
+	}
+	slot.number = number;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(index);
+	}
+	queueCondition.notify_one();
+	return true;
+}
+
+FrameCapture::Stats FrameCapture::GetStats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+std::string FrameCapture::GetError() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return error;
+}
+
+void FrameCapture::encodeLoop() {
+	Profiler::SetThreadName("frame capture");
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		queueCondition.wait(lock, [&]{ return stopping || !queue.empty(); });
+		// the queued frames are still written when stopping
+		if (queue.empty()) return;
+
+		int index = queue.front();
+		queue.pop_front();
+		lock.unlock();
+		encode(slots[index]);
+		lock.lock();
+
+		stats.written++;
+		freeSlots.push_back(index);
+		freeCondition.notify_one();
+	}
+}
+
+void FrameCapture::encode(Slot& slot) {
+	PROFILE_ZONE("FrameCapture::encode");
+	switch (format) {
+		case Format::Raw:
+			writeRaw(slot.frame);
+			return;
+		case Format::Y4M:
+			writeY4M(slot.frame);
+			return;
+		default:
+			break;
+	}
+
+	cdr::BaseBitmap::Formats formats[] {
+		cdr::BaseBitmap::Formats::PNG,
+		cdr::BaseBitmap::Formats::BMP,
+		cdr::BaseBitmap::Formats::TGA,
+		cdr::BaseBitmap::Formats::JPG,
+	};
+	slot.frame.SaveAs(path + std::to_string(slot.number), formats[(int)format - (int)Format::PNG]);
+}
+
+void FrameCapture::writeRaw(const cdr::RGBABitmap& frame) {
+	// NOTE: RGBA in memory order, whatever the byte order of the machine
+	row.resize(frame.GetWidth() * sizeof(uint32_t));
+	for (int y = 0; y < frame.GetHeight(); y++) {
+		cdr::SwapRGBAtoABGR(frame.GetData() + (size_t)y * frame.GetPitch(), reinterpret_cast<uint32_t*>(row.data()), frame.GetWidth());
+		out->write(reinterpret_cast<const char*>(row.data()), row.size());
+	}
+	out->flush();
+	if (!*out) fail("can't write to " + path);
+}
+
+void FrameCapture::writeY4M(const cdr::RGBABitmap& frame) {
+	if (streamWidth == 0) {
+		// the stream keeps the size of the first frame
+		streamWidth = frame.GetWidth();
+		streamHeight = frame.GetHeight();
+		long long rate = std::llround(frameRate * 1000);
+		*out << "YUV4MPEG2 W" << streamWidth << " H" << streamHeight << " F" << rate << ":1000 Ip A1:1 C444 XCOLORRANGE=FULL\n";
+	}
+
+	// full range BT.601, frames of another size are cropped or padded with black
+	size_t planeSize = (size_t)streamWidth * streamHeight;
+	row.assign(planeSize * 3, 0);
+	std::fill(row.begin() + planeSize, row.end(), 128);
+	uint8_t* yPlane = row.data();
+	uint8_t* uPlane = yPlane + planeSize;
+	uint8_t* vPlane = uPlane + planeSize;
+	int width = std::min(streamWidth, frame.GetWidth());
+	int height = std::min(streamHeight, frame.GetHeight());
+	for (int y = 0; y < height; y++) {
+		const uint32_t* source = frame.GetData() + (size_t)y * frame.GetPitch();
+		size_t offset = (size_t)y * streamWidth;
+		for (int x = 0; x < width; x++) {
+			int r = cdr::getR(source[x]);
+			int g = cdr::getG(source[x]);
+			int b = cdr::getB(source[x]);
+			yPlane[offset + x] = (77 * r + 150 * g + 29 * b + 128) >> 8;
+			uPlane[offset + x] = ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128;
+			vPlane[offset + x] = ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128;
+		}
+	}
+	*out << "FRAME\n";
+	out->write(reinterpret_cast<const char*>(row.data()), row.size());
+	out->flush();
+	if (!*out) fail("can't write to " + path);
+}
+
+void FrameCapture::fail(const std::string& message) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (error.empty()) error = message;
+}
@@ -0,0 +1,102 @@
+#ifndef FRAME_CAPTURE_HPP
+#define FRAME_CAPTURE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cidr.hpp"
+
+// Writes frames on a background thread. Submit() copies the frame into one of a ring of
+// bitmaps and returns, the encoder thread writes them out in order and gives the bitmaps back.
+// The bitmaps are only reallocated when the frame size changes, and then from the pixel pool.
+class FrameCapture {
+public:
+	static constexpr int DefaultRingSize = 8;
+
+	enum class Format {
+		Raw, // 8 bit RGBA, row by row, all frames appended to one file
+		PNG,
+		BMP,
+		TGA,
+		JPG,
+		Y4M, // YUV4MPEG2 4:4:4 stream, e.g. for piping into ffmpeg
+	};
+
+	// what Submit() does when every bitmap of the ring is still queued
+	enum class Overflow {
+		Drop, // skip the frame, the caller never waits for the disk
+		Wait, // block until the encoder caught up, every frame gets written
+	};
+
+	struct Stats {
+		uint64_t submitted{0};
+		uint64_t written{0};
+		uint64_t dropped{0};
+	};
+
+	FrameCapture() = default;
+	~FrameCapture();
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// Raw and Y4M frames are appended to path ("-" is stdout), the image formats write one file
+	// per frame named path + frame number + extension. The frame rate only goes into the Y4M header.
+	// Returns false if the stream can't be opened.
+	bool Start(const std::string& path, Format format, Overflow overflow = Overflow::Drop, double frameRate = 60, int ringSize = DefaultRingSize);
+	// Writes the frames that are still queued and stops the encoder thread
+	void Stop();
+
+	// Copies the frame, number names the file for the image formats.
+	// Returns false if it was dropped.
+	bool Submit(const cdr::BitmapView& frame, uint64_t number);
+
+	inline bool IsCapturing() const { return capturing; }
+	inline Format GetFormat() const { return format; }
+	Stats GetStats() const;
+	// the first write that failed
+	std::string GetError() const;
+
+private:
+	struct Slot {
+		cdr::RGBABitmap frame{0, 0};
+		uint64_t number{0};
+	};
+
+	bool capturing{false};
+	Format format{Format::Raw};
+	Overflow overflow{Overflow::Drop};
+	std::string path;
+	double frameRate{60};
+	std::ofstream file;
+	std::ostream* out{nullptr};
+
+	mutable std::mutex mutex;
+	std::condition_variable queueCondition;
+	std::condition_variable freeCondition;
+	std::vector<Slot> slots;
+	std::deque<int> freeSlots;
+	std::deque<int> queue;
+	bool stopping{false};
+	std::thread encoder;
+	Stats stats;
+	std::string error;
+
+	// only touched by the encoder thread
+	std::vector<uint8_t> row;
+	int streamWidth{0};
+	int streamHeight{0};
+
+	void encodeLoop();
+	void encode(Slot& slot);
+	void writeRaw(const cdr::RGBABitmap& frame);
+	void writeY4M(const cdr::RGBABitmap& frame);
+	void fail(const std::string& message);
+};
+
+#endif /* FRAME_CAPTURE_HPP */
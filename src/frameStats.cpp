@@ -0,0 +1,74 @@
+#include "frameStats.hpp"
+#include "percentile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+double FrameStats::Tick() {
+	// the first call only starts the clock
+	if (!started) {
+		started = true;
+		frameTimer.reset();
+		return 0;
+	}
+
+	lastFrameSeconds = frameTimer.elapsedSeconds();
+	frameTimer.reset();
+	frameSeconds[next] = lastFrameSeconds;
+	next = (next + 1) % WindowSize;
+	count = std::min(count + 1, WindowSize);
+	return lastFrameSeconds;
+}
+
+void FrameStats::Pace() {
+	if (targetFrameSeconds <= 0 || !started) return;
+
+	double remaining = targetFrameSeconds - frameTimer.elapsedSeconds();
+	if (remaining > SpinSeconds) {
+		std::this_thread::sleep_for(std::chrono::duration<double>(remaining - SpinSeconds));
+	}
+	while (frameTimer.elapsedSeconds() < targetFrameSeconds) {
+		std::this_thread::yield();
+	}
+}
+
+void FrameStats::SetTargetFps(double fps) {
+	targetFrameSeconds = fps > 0 ? 1.0 / fps : 0;
+}
+
+FrameStats::Summary FrameStats::GetSummary() const {
+	Summary summary;
+	summary.frames = count;
+	if (count == 0) return summary;
+
+	std::array<double, WindowSize> sorted;
+	std::copy_n(frameSeconds.begin(), count, sorted.begin());
+	std::sort(sorted.begin(), sorted.begin() + count);
+
+	auto rank = [&](double p) {
+		return NearestRank(sorted.data(), count, p) * 1000.0;
+	};
+	double sum = 0;
+	for (int i = 0; i < count; i++) sum += sorted[i];
+
+	summary.p50 = rank(0.50);
+	summary.p95 = rank(0.95);
+	summary.p99 = rank(0.99);
+	summary.max = sorted[count - 1] * 1000.0;
+	summary.mean = sum / count * 1000.0;
+	return summary;
+}
+
+std::string FrameStats::Format() const {
+	Summary s = GetSummary();
+	char text[160];
+	snprintf(text, sizeof(text), "fps %.1f\np50 %.2f ms\np95 %.2f ms\np99 %.2f ms\nmax %.2f ms",
+		s.mean > 0 ? 1000.0 / s.mean : 0.0, s.p50, s.p95, s.p99, s.max);
+	return text;
+}
+
+void FrameStats::DrawOverlay(cdr::Renderer& renderer, int x, int y) const {
+	static const cdr::TextStyle style{cdr::Fonts::Raster8x12, false, cdr::TextAlignment::TL, 1, cdr::RGB::White, cdr::RGB::Black};
+	renderer.DrawText(Format(), x, y, style);
+}
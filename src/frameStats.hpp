@@ -0,0 +1,54 @@
+#ifndef FRAME_STATS_HPP
+#define FRAME_STATS_HPP
+
+#include <array>
+#include <string>
+#include "cidr.hpp"
+#include "timer.hpp"
+
+// Rolling frame time statistics over the last WindowSize frames and optional frame pacing.
+// Call Tick() once at the start of every frame and Pace() at the end of it.
+class FrameStats {
+public:
+	static constexpr int WindowSize = 240;
+	// Pace() sleeps until this long before the deadline and spins for the rest,
+	// because sleeping isn't precise enough on its own
+	static constexpr double SpinSeconds = 0.002;
+
+	// all in milliseconds
+	struct Summary {
+		double p50{0};
+		double p95{0};
+		double p99{0};
+		double max{0};
+		double mean{0};
+		int frames{0};
+	};
+
+	FrameStats() = default;
+
+	// Records the time since the last Tick() and returns it in seconds
+	double Tick();
+	// Waits until the frame took 1 / target fps, does nothing without a target
+	void Pace();
+	// 0 turns pacing off
+	void SetTargetFps(double fps);
+	Summary GetSummary() const;
+	// a few lines with fps and percentiles, e.g. for the overlay or printing at exit
+	std::string Format() const;
+	void DrawOverlay(cdr::Renderer& renderer, int x = 4, int y = 4) const;
+
+	inline double GetTargetFps() const { return targetFrameSeconds > 0 ? 1.0 / targetFrameSeconds : 0; }
+	inline double GetLastFrameSeconds() const { return lastFrameSeconds; }
+
+private:
+	Timer frameTimer;
+	std::array<double, WindowSize> frameSeconds{};
+	int count{0};
+	int next{0};
+	double lastFrameSeconds{0};
+	double targetFrameSeconds{0};
+	bool started{false};
+};
+
+#endif /* FRAME_STATS_HPP */
@@ -0,0 +1,102 @@
+#include "framebuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+Framebuffer::Framebuffer(int width, int height) {
+	Resize(width, height);
+}
+
+Framebuffer::~Framebuffer() {
+	delete[] pixels;
+}
+
+Framebuffer::Framebuffer(Framebuffer&& other) noexcept {
+	*this = std::move(other);
+}
+
+Framebuffer& Framebuffer::operator=(Framebuffer&& other) noexcept {
+	if (this == &other) return *this;
+
+	delete[] pixels;
+	pixels = other.pixels;
+	width = other.width;
+	height = other.height;
+	capacityWidth = other.capacityWidth;
+	capacityHeight = other.capacityHeight;
+	// the pixels of this buffer moved, so it counts as a reallocation
+	generation = std::max(generation, other.generation) + 1;
+	other.pixels = nullptr;
+	other.width = other.height = other.capacityWidth = other.capacityHeight = 0;
+	return *this;
+}
+
+bool Framebuffer::Resize(int width, int height) {
+	width = std::max(width, 0);
+	height = std::max(height, 0);
+
+	bool moved = false;
+	if (width > capacityWidth || height > capacityHeight) {
+		auto grow = [](int capacity, int size) {
+			return size > capacity ? std::max(size, (int)(capacity * GrowthFactor)) : capacity;
+		};
+		reallocate(grow(capacityWidth, width), grow(capacityHeight, height));
+		moved = true;
+	}
+
+	// clear what wasn't part of the old size
+	for (int y = 0; y < std::min(height, this->height); y++) {
+		if (width > this->width) {
+			std::fill_n(pixels + y * capacityWidth + this->width, width - this->width, 0);
+		}
+	}
+	for (int y = this->height; y < height; y++) {
+		std::fill_n(pixels + y * capacityWidth, width, 0);
+	}
+
+	this->width = width;
+	this->height = height;
+	return moved;
+}
+
+bool Framebuffer::Reserve(int width, int height) {
+	if (width <= capacityWidth && height <= capacityHeight) return false;
+	reallocate(std::max(width, capacityWidth), std::max(height, capacityHeight));
+	return true;
+}
+
+bool Framebuffer::ShrinkToFit() {
+	if ((int64_t)capacityWidth * capacityHeight <= 2 * (int64_t)width * height) return false;
+	reallocate(width, height);
+	return true;
+}
+
+void Framebuffer::Clear(uint32_t color) {
+	for (int y = 0; y < height; y++) {
+		std::fill_n(pixels + y * capacityWidth, width, color);
+	}
+}
+
+void Framebuffer::CopyFrom(const Framebuffer& other) {
+	Resize(other.width, other.height);
+	for (int y = 0; y < height; y++) {
+		memcpy(pixels + y * capacityWidth, other.pixels + y * other.capacityWidth, width * sizeof(uint32_t));
+	}
+}
+
+void Framebuffer::reallocate(int newCapacityWidth, int newCapacityHeight) {
+	uint32_t* newPixels = new uint32_t[(size_t)newCapacityWidth * newCapacityHeight]();
+	int rows = std::min(height, newCapacityHeight);
+	int columns = std::min(width, newCapacityWidth);
+	for (int y = 0; y < rows; y++) {
+		memcpy(newPixels + y * newCapacityWidth, pixels + y * capacityWidth, columns * sizeof(uint32_t));
+	}
+
+	delete[] pixels;
+	pixels = newPixels;
+	capacityWidth = newCapacityWidth;
+	capacityHeight = newCapacityHeight;
+	width = std::min(width, newCapacityWidth);
+	height = std::min(height, newCapacityHeight);
+	generation++;
+}
@@ -0,0 +1,55 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+
+#include <cstdint>
+
+// A pixel buffer whose allocation can be bigger than its size, so resizing back and forth
+// (e.g. while dragging a window edge) doesn't reallocate every time. Rows are GetPitch()
+// pixels apart, which is the capacity width and not the width.
+class Framebuffer {
+public:
+	// capacity grows by at least this factor when exceeded
+	static constexpr float GrowthFactor = 1.5f;
+
+	Framebuffer() = default;
+	Framebuffer(int width, int height);
+	~Framebuffer();
+
+	Framebuffer(const Framebuffer&) = delete;
+	Framebuffer& operator=(const Framebuffer&) = delete;
+	Framebuffer(Framebuffer&& other) noexcept;
+	Framebuffer& operator=(Framebuffer&& other) noexcept;
+
+	// Keeps the pixels that are inside the old and the new size, newly exposed pixels are cleared.
+	// Returns true if the buffer had to be reallocated (and moved).
+	bool Resize(int width, int height);
+	// Makes sure the buffer can hold width * height pixels without reallocating, the size stays the same
+	bool Reserve(int width, int height);
+	// Reallocates to exactly the current size, if the capacity holds more than twice as many pixels
+	bool ShrinkToFit();
+	void Clear(uint32_t color = 0);
+	// Resizes to the size of other and copies its pixels
+	void CopyFrom(const Framebuffer& other);
+
+	inline uint32_t* GetPixels() { return pixels; }
+	inline const uint32_t* GetPixels() const { return pixels; }
+	inline int GetWidth() const { return width; }
+	inline int GetHeight() const { return height; }
+	inline int GetPitch() const { return capacityWidth; }
+	inline int GetCapacityWidth() const { return capacityWidth; }
+	inline int GetCapacityHeight() const { return capacityHeight; }
+	// incremented every time the buffer gets reallocated
+	inline uint64_t GetGeneration() const { return generation; }
+
+private:
+	uint32_t* pixels{nullptr};
+	int width{0};
+	int height{0};
+	int capacityWidth{0};
+	int capacityHeight{0};
+	uint64_t generation{0};
+
+	void reallocate(int newCapacityWidth, int newCapacityHeight);
+};
+
+#endif /* FRAMEBUFFER_HPP */
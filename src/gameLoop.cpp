@@ -0,0 +1,105 @@
+#include "gameLoop.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+GameLoop::GameLoop(double tickSeconds, int maxCatchUpTicks) : tickSeconds(tickSeconds), maxCatchUpTicks(std::max(maxCatchUpTicks, 1)) {
+}
+
+GameLoop::~GameLoop() {
+	StopThread();
+}
+
+void GameLoop::SetSimulation(Simulation simulation) {
+	this->simulation = std::move(simulation);
+}
+
+void GameLoop::tick() {
+	ticks++;
+	if (simulation) simulation(tickSeconds);
+}
+
+int GameLoop::Advance(double frameSeconds) {
+	if (threaded) return 0;
+
+	accumulator += frameSeconds;
+	int ran = 0;
+	while (accumulator >= tickSeconds) {
+		if (ran == maxCatchUpTicks) {
+			// the simulation can't keep up, rather slow down than spiral
+			double behind = std::floor(accumulator / tickSeconds);
+			droppedTicks += (uint64_t)behind;
+			accumulator -= behind * tickSeconds;
+			break;
+		}
+		tick();
+		accumulator -= tickSeconds;
+		ran++;
+	}
+	return ran;
+}
+
+void GameLoop::StartThread() {
+	if (threaded) return;
+	// continue where the single threaded ticks left off
+	startNanos = nowNanos() - (int64_t)((ticks * tickSeconds + accumulator) * 1e9);
+	accumulator = 0;
+	stopping = false;
+	threaded = true;
+	thread = std::thread(&GameLoop::threadLoop, this);
+}
+
+void GameLoop::StopThread() {
+	if (!threaded) return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	stopCondition.notify_all();
+	thread.join();
+	threaded = false;
+}
+
+void GameLoop::threadLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!stopping) {
+		int64_t now = nowNanos();
+		int64_t due = startNanos + (int64_t)((ticks + 1) * tickSeconds * 1e9);
+		if (now < due) {
+			stopCondition.wait_until(lock, Clock::time_point(std::chrono::nanoseconds(due)), [&]{ return stopping; });
+			continue;
+		}
+
+		uint64_t behind = (uint64_t)((now - startNanos) / (tickSeconds * 1e9)) - ticks;
+		if (behind > (uint64_t)maxCatchUpTicks) {
+			// move the schedule instead of simulating the time that was missed
+			uint64_t dropped = behind - maxCatchUpTicks;
+			droppedTicks += dropped;
+			startNanos += (int64_t)(dropped * tickSeconds * 1e9);
+		}
+
+		lock.unlock();
+		tick();
+		lock.lock();
+	}
+}
+
+double GameLoop::GetSimulationTime() const {
+	return ticks * tickSeconds;
+}
+
+double GameLoop::GetAlpha(double stateTime) const {
+	double alpha = (getTime() - stateTime) / tickSeconds;
+	return std::clamp(alpha, 0.0, 1.0);
+}
+
+double GameLoop::getTime() const {
+	if (threaded) {
+		return (nowNanos() - startNanos) * 1e-9;
+	}
+	return ticks * tickSeconds + accumulator;
+}
+
+int64_t GameLoop::nowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
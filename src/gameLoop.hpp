@@ -0,0 +1,102 @@
+#ifndef GAME_LOOP_HPP
+#define GAME_LOOP_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs a simulation at a fixed tick, independent of the frame rate. Either call Advance() once
+// per frame with the frame time, or StartThread() to tick on a thread of its own.
+// Rendering lags one tick behind and interpolates between the last two ticks: states are tagged
+// with GetSimulationTime() and GetAlpha() tells how far between the previous state and that one
+// the current frame is.
+class GameLoop {
+public:
+	// more ticks than that aren't caught up in one go, the time is dropped instead
+	static constexpr int DefaultMaxCatchUpTicks = 5;
+
+	using Simulation = std::function<void(double tickSeconds)>;
+
+	GameLoop(double tickSeconds, int maxCatchUpTicks = DefaultMaxCatchUpTicks);
+	~GameLoop();
+
+	GameLoop(const GameLoop&) = delete;
+	GameLoop& operator=(const GameLoop&) = delete;
+
+	// Called for every tick, on the simulation thread if there is one
+	void SetSimulation(Simulation simulation);
+	// Runs the ticks that are due after frameSeconds, returns how many ran
+	int Advance(double frameSeconds);
+	void StartThread();
+	void StopThread();
+
+	// time of the state after the last tick, or of the tick that is running right now
+	double GetSimulationTime() const;
+	// 0 to 1 from the state before the one at stateTime to that state
+	double GetAlpha(double stateTime) const;
+
+	inline double GetTickSeconds() const { return tickSeconds; }
+	inline uint64_t GetTicks() const { return ticks; }
+	inline uint64_t GetDroppedTicks() const { return droppedTicks; }
+	inline bool IsThreaded() const { return threaded; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	double tickSeconds;
+	int maxCatchUpTicks;
+	Simulation simulation;
+	std::atomic<uint64_t> ticks{0};
+	std::atomic<uint64_t> droppedTicks{0};
+
+	// single threaded: the time that's left over after the last tick
+	double accumulator{0};
+
+	// threaded: tick n runs at start + n * tickSeconds
+	bool threaded{false};
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable stopCondition;
+	bool stopping{false};
+	std::atomic<int64_t> startNanos{0};
+
+	void tick();
+	void threadLoop();
+	double getTime() const;
+	static int64_t nowNanos();
+};
+
+// Hands the newest of a stream of values from one writer thread to one reader thread without
+// locking or copying. The writer fills Back() and publishes it, the reader gets the newest
+// published value with Acquire(), which stays valid until the next Acquire().
+template<typename T>
+class TripleBuffer {
+public:
+	inline T& Back() {
+		return buffers[back];
+	}
+	inline void Publish() {
+		back = middle.exchange(back | FreshBit) & IndexMask;
+	}
+	inline const T& Acquire() {
+		if (middle.load() & FreshBit) {
+			front = middle.exchange(front) & IndexMask;
+		}
+		return buffers[front];
+	}
+
+private:
+	static constexpr int FreshBit = 4;
+	static constexpr int IndexMask = 3;
+
+	T buffers[3];
+	int back{0};
+	std::atomic<int> middle{1};
+	int front{2};
+};
+
+#endif /* GAME_LOOP_HPP */
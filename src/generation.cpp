@@ -1,5 +1,11 @@
 #include <time.h>
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "generation.hpp"
+#include "timer.hpp"
 
 Generation::Generation(int WIDTH, int HEIGHT, int borderLeft, int borderRight, int borderUp, int borderDown)
 :WIDTH(WIDTH),HEIGHT(HEIGHT),borderLeft(borderLeft),borderRight(borderRight),
@@ -25,6 +31,14 @@ int Generation::Start(int amountOfRooms, int minWidth, int maxWidth, int minHeig
     rooms.reserve(amountOfRooms);
     oarea_rooms.reserve(amountOfRooms);
 
+    Timer totalTimer, phaseTimer;
+    // adds the time since the last phase ended to the given Stats field
+    auto endPhase = [&](double Stats::* seconds){
+        if(!stats) return;
+        stats->*seconds += phaseTimer.elapsedSeconds();
+        phaseTimer.reset();
+    };
+
     //this is probably uneccesery
     POS spawnPoint = POS(dungeonHeight / 2, dungeonWidth / 2);
     SpawnHouse(minWidth, maxWidth, minHeight, maxHeight, spawnPoint);
@@ -32,6 +46,8 @@ int Generation::Start(int amountOfRooms, int minWidth, int maxWidth, int minHeig
     for(int i = 0; i < amountOfRooms; i++){
         SpawnHouse(minWidth, maxWidth, minHeight, maxHeight);
     }
+    if(stats) stats->roomsPlaced += rooms.size();
+    endPhase(&Stats::placementSeconds);
     
     //shiftPart
     POS leftp =  POS(0,dungeonWidth+1),
@@ -62,7 +78,8 @@ int Generation::Start(int amountOfRooms, int minWidth, int maxWidth, int minHeig
     
     //horizontal shift
     int diff;
-    int horizontalShift = 0, verticalShift = 0;
+    horizontalShift = 0;
+    verticalShift = 0;
     
     //then center the whole rooms on the dungeon
     while(1){
@@ -94,10 +111,10 @@ int Generation::Start(int amountOfRooms, int minWidth, int maxWidth, int minHeig
         }
     
     //spawn player
-    int playerRoom = rand() % rooms.size();
+    int playerRoom = Random() % rooms.size();
     POS p;
     do{
-        int j = rand() % rooms[playerRoom].size();
+        int j = Random() % rooms[playerRoom].size();
             p = rooms[playerRoom][j];
     }while(map[p.x + borderUp + verticalShift][p.y + borderRight + horizontalShift] == Tile_Wall);
     map[p.x + borderUp + verticalShift][p.y+ borderRight + horizontalShift] = Tile_Player;
@@ -119,7 +136,7 @@ int Generation::Start(int amountOfRooms, int minWidth, int maxWidth, int minHeig
         // enemyTotal += enemies;
         int eamount = 0;
         do{
-            int i = rand() % rooms[j].size();
+            int i = Random() % rooms[j].size();
             POS p = POS(rooms[j][i].x + borderUp + verticalShift, rooms[j][i].y + borderRight + horizontalShift);
             if(map[p.x][p.y] != Tile_Wall && map[p.x][p.y] != Tile_Enemy){
                 eamount++;
@@ -130,6 +147,8 @@ int Generation::Start(int amountOfRooms, int minWidth, int maxWidth, int minHeig
         //for(int l = 0; l < HEIGHT; l++)
         //   std::cout << map[l] << std::endl;
     
+    endPhase(&Stats::shiftSeconds);
+    
     //fill out the empty tiles here...
     std::vector<POS> emptyspace;
     for(int k = 0; k < HEIGHT-2; k++)
@@ -140,6 +159,11 @@ int Generation::Start(int amountOfRooms, int minWidth, int maxWidth, int minHeig
                         emptyspace.push_back(POS(k,j+1));
                         isValidSpace = true;
                         TryFillOutSpacing(POS(k,j+1), emptyspace);
+                        if(stats){
+                            stats->floodFills++;
+                            stats->floodFillTiles += emptyspace.size();
+                            stats->maxFloodFill = std::max(stats->maxFloodFill, (int)emptyspace.size());
+                        }
                         for(POS p : emptyspace)
                             map[p.x][p.y] = Tile_Floor;
                         emptyspace.clear();
@@ -147,27 +171,18 @@ int Generation::Start(int amountOfRooms, int minWidth, int maxWidth, int minHeig
             }
         }
     
+    endPhase(&Stats::fillSeconds);
+    
+    size_t doorCount = doors.size();
     SpawnDoors(verticalShift, horizontalShift);
+    if(stats) stats->doorsSpawned += doors.size() - doorCount;
+    endPhase(&Stats::doorSeconds);
     
     
     //removing the small space between walls
-    for(int j = 0; j < HEIGHT; j++){
-        for(int i = 0; i < WIDTH; i++){
-            if(map[j][i] == Tile_Wall){
-                if (i+2 < WIDTH && i-1 >= 0 && map[j][i-1] == Tile_Floor && map[j][i+1] == Tile_Floor && map[j][i+2] == Tile_Wall)
-                    map[j][i] = Tile_Floor;
-                
-                if (i-2 >= 0 && i+1 < WIDTH && map[j][i+1] == Tile_Floor && map[j][i-1] == Tile_Floor && map[j][i-2] == Tile_Wall)
-                    map[j][i] = Tile_Floor;
-            
-                if (j+2 < HEIGHT && j-1 >= 0 && map[j-1][i] == Tile_Floor && map[j+1][i] == Tile_Floor && map[j+2][i] == Tile_Wall)
-                    map[j][i] = Tile_Floor;
-            
-                if (j-2 >= 0 && j+1 < HEIGHT && map[j+1][i] == Tile_Floor && map[j-1][i] == Tile_Floor && map[j-2][i] == Tile_Wall)
-                    map[j][i] = Tile_Floor;
-            }
-        }
-    }
+    RemoveThinWalls();
+    endPhase(&Stats::cleanupSeconds);
+    if(stats) stats->totalSeconds += totalTimer.elapsedSeconds();
     return 0;
 }
 
@@ -185,7 +200,8 @@ void Generation::OpenSpace(POS pos,std::vector<POS>& spacing){
     if(!spacing.empty() && spacing[spacing.size()-1] == pos)
         return;
     
-    if(pos.x >= dungeonWidth || pos.y >= dungeonHeight || pos.x <=  borderUp || pos.y <= borderLeft){
+    // NOTE: POS::x is the row, so it's bounded by the height
+    if(pos.x >= dungeonHeight || pos.y >= dungeonWidth || pos.x <=  borderUp || pos.y <= borderLeft){
         isValidSpace = false;
         spacing.clear();
         return;
@@ -202,33 +218,27 @@ void Generation::OpenSpace(POS pos,std::vector<POS>& spacing){
 }
 
 void Generation::SpawnDoors(int verticalShift, int horizontalShift){
-    POS p;
-    for(int j = 0; j < connectpoints.size(); j++){ //vector
-        for(int i = 0; i < connectpoints[j].size(); i++){ //array
-            
-            int c = 0;
-            while(1){
-                if(c > connectpoints[j][i].size()-1 || connectpoints[j][i].empty())
-                    break;
-                p = connectpoints[j][i][c];
-                p.x += borderUp + verticalShift;
-                p.y += borderRight + horizontalShift;
-                if(!(map[p.x+1][p.y] == Tile_Floor && map[p.x-1][p.y] == Tile_Floor) &&
-                    !(map[p.x][p.y+1] == Tile_Floor && map[p.x][p.y-1] == Tile_Floor)){
-                    connectpoints[j][i].erase(connectpoints[j][i].begin() + c);
-                    continue;
-                }
-                c++;
-            }
+    BuildMasks();
+    auto toMap = [&](POS p){
+        return POS(p.x + borderUp + verticalShift, p.y + borderRight + horizontalShift);
+    };
+    
+    for(auto& sides : connectpoints){
+        for(auto& points : sides){
+            //only keep the points which would connect two floors
+            points.erase(std::remove_if(points.begin(), points.end(), [&](const POS& point){
+                POS p = toMap(point);
+                return !(IsFloor(p.x+1, p.y) && IsFloor(p.x-1, p.y)) &&
+                    !(IsFloor(p.x, p.y+1) && IsFloor(p.x, p.y-1));
+            }), points.end());
             
-            if(connectpoints[j][i].empty())
+            if(points.empty())
                 continue;
             
-            if(connectpoints[j][i].size() == 1){
-                p = connectpoints[j][i][0];
-                p.x += borderUp + verticalShift;
-                p.y += borderRight + horizontalShift;
-                map[p.x][p.y] = Tile_Floor;
+            if(points.size() == 1){
+                POS p = toMap(points[0]);
+                SetTile(p.x, p.y, Tile_Floor);
+                doors.push_back(p);
                 continue;
             }
             
@@ -236,22 +246,131 @@ void Generation::SpawnDoors(int verticalShift, int horizontalShift){
             int end;
             
             do{
-                start = rand() % (connectpoints[j][i].size()-1);
-                end = rand() % (connectpoints[j][i].size() - start);
+                start = Random() % (points.size()-1);
+                end = Random() % (points.size() - start);
             } while((start+end)-start < 1);
             
             for(int k = start; k < start + end; k++){
-                p = connectpoints[j][i][k];
-                p.x += borderUp + verticalShift;
-                p.y += borderRight + horizontalShift;
-                map[p.x][p.y] = Tile_Floor;
+                POS p = toMap(points[k]);
+                SetTile(p.x, p.y, Tile_Floor);
+                doors.push_back(p);
             }
         }
-        
-        // for(int l = 0; l < HEIGHT; l++)
-            //  std::cout << map[l] << std::endl;
+    }
+}
+
+#ifndef __SSE2__
+// one bit per byte of the 8 chars in tiles (first char in bit 0) that equal tile
+// NOTE: assumes a little endian machine
+static uint64_t matchBytes(uint64_t tiles, char tile){
+    uint64_t diff = tiles ^ (0x0101010101010101ull * (uint8_t)tile);
+    // 0x80 in every byte of diff that is zero
+    uint64_t zero = ~(((diff & 0x7f7f7f7f7f7f7f7full) + 0x7f7f7f7f7f7f7f7full) | diff | 0x7f7f7f7f7f7f7f7full);
+    // gather the high bits of all bytes into the top byte
+    return (zero >> 7) * 0x0102040810204080ull >> 56;
+}
+#endif
+
+void Generation::BuildMasks(){
+    maskWords = (WIDTH + 63) / 64;
+    wallMask.assign(maskWords * HEIGHT, 0);
+    floorMask.assign(maskWords * HEIGHT, 0);
+    for(int j = 0; j < HEIGHT; j++){
+        const char* row = map[j].data();
+        uint64_t* walls = &wallMask[j * maskWords];
+        uint64_t* floors = &floorMask[j * maskWords];
+        int i = 0;
+        for(; i + 64 <= WIDTH; i += 64){
+            uint64_t wall = 0, floor = 0;
+#ifdef __SSE2__
+            const __m128i wallTile = _mm_set1_epi8(Tile_Wall), floorTile = _mm_set1_epi8(Tile_Floor);
+            for(int b = 0; b < 64; b += 16){
+                __m128i tiles = _mm_loadu_si128((const __m128i*)(row + i + b));
+                wall |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(tiles, wallTile)) << b;
+                floor |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(tiles, floorTile)) << b;
+            }
+#else
+            for(int b = 0; b < 64; b += 8){
+                uint64_t tiles;
+                memcpy(&tiles, row + i + b, 8);
+                wall |= matchBytes(tiles, Tile_Wall) << b;
+                floor |= matchBytes(tiles, Tile_Floor) << b;
+            }
+#endif
+            walls[i / 64] = wall;
+            floors[i / 64] = floor;
+        }
+        for(; i < WIDTH; i++){
+            walls[i / 64] |= (uint64_t)(row[i] == Tile_Wall) << (i % 64);
+            floors[i / 64] |= (uint64_t)(row[i] == Tile_Floor) << (i % 64);
+        }
+    }
+}
+
+bool Generation::IsFloor(int row, int col) const{
+    if(row < 0 || col < 0 || row >= HEIGHT || col >= WIDTH) return false;
+    return floorMask[row * maskWords + col / 64] >> (col % 64) & 1;
+}
+
+void Generation::SetTile(int row, int col, char tile){
+    map[row][col] = tile;
+    uint64_t bit = (uint64_t)1 << (col % 64);
+    int word = row * maskWords + col / 64;
+    wallMask[word] = tile == Tile_Wall ? wallMask[word] | bit : wallMask[word] & ~bit;
+    floorMask[word] = tile == Tile_Floor ? floorMask[word] | bit : floorMask[word] & ~bit;
+}
+
+// word w of a row mask with every bit i taken from bit i + offset, offset in [-63, 63] and not 0
+static uint64_t shiftedWord(const uint64_t* row, int words, int w, int offset){
+    if(offset > 0){
+        uint64_t next = w + 1 < words ? row[w+1] : 0;
+        return (row[w] >> offset) | (next << (64 - offset));
+    }
+    uint64_t prev = w > 0 ? row[w-1] : 0;
+    return (row[w] << -offset) | (prev >> (64 + offset));
+}
+
+static int lowestBit(uint64_t v){
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(v);
+#else
+    int i = 0;
+    while(!(v & 1)){ v >>= 1; i++; }
+    return i;
+#endif
+}
+
+// Turns walls into floor if they're only one tile thick between two floors and the
+// wall continues behind one of the floors (#.#.  or  .#.# in a row or column).
+// All walls are checked against the map as it was before the pass and changed at once.
+void Generation::RemoveThinWalls(){
+    std::vector<uint64_t> empty(maskWords, 0);
+    auto row = [&](const std::vector<uint64_t>& mask, int j){
+        return (j < 0 || j >= HEIGHT) ? empty.data() : &mask[j * maskWords];
+    };
+    
+    std::vector<uint64_t> remove(wallMask.size(), 0);
+    for(int j = 0; j < HEIGHT; j++){
+        const uint64_t* walls = row(wallMask, j);
+        const uint64_t* floors = row(floorMask, j);
+        const uint64_t *up = row(floorMask, j-1), *down = row(floorMask, j+1);
+        const uint64_t *up2 = row(wallMask, j-2), *down2 = row(wallMask, j+2);
+        for(int w = 0; w < maskWords; w++){
+            if(!walls[w]) continue;
+            uint64_t horizontal = shiftedWord(floors, maskWords, w, -1) & shiftedWord(floors, maskWords, w, 1) &
+                (shiftedWord(walls, maskWords, w, -2) | shiftedWord(walls, maskWords, w, 2));
+            uint64_t vertical = up[w] & down[w] & (up2[w] | down2[w]);
+            remove[j * maskWords + w] = walls[w] & (horizontal | vertical);
+        }
     }
     
+    for(int j = 0; j < HEIGHT; j++){
+        for(int w = 0; w < maskWords; w++){
+            for(uint64_t bits = remove[j * maskWords + w]; bits; bits &= bits - 1){
+                SetTile(j, w * 64 + lowestBit(bits), Tile_Floor);
+            }
+        }
+    }
 }
 
 void Generation::SpawnHouse(const int& minWidth, const int& maxWidth, const int& minHeight, const int& maxHeight, const POS& pos){
@@ -263,27 +382,35 @@ void Generation::SpawnHouse(const int& minWidth, const int& maxWidth, const int&
 
     if(pos.y != 0 && pos.x != 0){
         //spawn the first room exactly in the middle of the map.
-        width = minWidth + (rand() % (maxWidth - minWidth));
-        height = minHeight + (rand() % (maxHeight - minHeight));
+        width = minWidth + (Random() % (maxWidth - minWidth));
+        height = minHeight + (Random() % (maxHeight - minHeight));
         x = pos.x-height/2;
         y = pos.y-width/2;
     } else {
         int dirX = 0, dirY = 0;
+        bool placed = false;
             do {
             if (minHeight - maxHeight != 0 && minWidth - maxWidth != 0) {
-                width = minWidth + (rand() % (maxWidth - minWidth));
-                height = minHeight + (rand() % (maxHeight - minHeight));
+                width = minWidth + (Random() % (maxWidth - minWidth));
+                height = minHeight + (Random() % (maxHeight - minHeight));
             } else {
                 width = maxWidth;
                 height = maxHeight;
             }
-            int i = rand() % walls.size();
+            int i = Random() % walls.size();
                 
-                dirX = (rand() % 2 == 0 ? 0 : 1);
-                dirY = (rand() % 2 == 0 ? 0 : 1);
+                dirX = (Random() % 2 == 0 ? 0 : 1);
+                dirY = (Random() % 2 == 0 ? 0 : 1);
                 x = walls[i].x - dirX * (height-1);
                 y = walls[i].y - dirY * (width-1);
-        } while((dirX == pdirectionX && dirY == pdirectionY) || !CanPlaceRoom(x,y,width,height));
+                
+                bool sameDirection = dirX == pdirectionX && dirY == pdirectionY;
+                placed = !sameDirection && CanPlaceRoom(x,y,width,height);
+                if(stats){
+                    stats->placementAttempts++;
+                    if(!sameDirection && !placed) stats->canPlaceRejects++;
+                }
+        } while(!placed);
         pdirectionY = dirY;
         pdirectionX = dirX;
     }
@@ -413,4 +540,8 @@ bool Generation::CanPlaceRoom(int x, int y, int width, int height){
     rooms = tempRooms;
     walls = tempWalls;
     return true;
-}
\ No newline at end of file
+}
+
+int Generation::Random(){
+    return rng() >> 1;
+}
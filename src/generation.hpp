@@ -1,7 +1,12 @@
+#ifndef GENERATION_HPP
+#define GENERATION_HPP
+
+#include <cstdint>
 #include <vector>
 #include <array>
 #include <string>
 #include <iostream>
+#include <random>
 
 class Generation{
     
@@ -32,6 +37,23 @@ public:
         }
     };
 
+    // Optional counters and per phase timings of Start, collected when Generation::stats is set
+    struct Stats{
+        int placementAttempts = 0;  // room positions tried by SpawnHouse
+        int canPlaceRejects = 0;    // tries rejected by CanPlaceRoom
+        int roomsPlaced = 0;
+        int floodFills = 0;         // flood fills started on enclosed empty space
+        int floodFillTiles = 0;     // tiles turned into floor by them
+        int maxFloodFill = 0;
+        int doorsSpawned = 0;
+        double placementSeconds = 0;
+        double shiftSeconds = 0;    // centering and writing the rooms to map, spawning player and enemies
+        double fillSeconds = 0;
+        double doorSeconds = 0;
+        double cleanupSeconds = 0;
+        double totalSeconds = 0;
+    };
+
     int WIDTH = 0,HEIGHT = 0;
     int dungeonWidth = 0, dungeonHeight = 0;
     int borderLeft = 0, borderRight = 0, borderUp = 0, borderDown = 0;
@@ -41,14 +63,30 @@ public:
     std::vector<std::array<std::vector<POS>,4>> connectpoints; //the doors can spawn here
     std::vector<std::vector<POS>> oarea_rooms; // all rooms, but they contain only the inner room section(if this section is overlapsed by a room, it has to respawn)
     int spacing = 2; // room spacing
+    std::vector<POS> doors; // door tiles carved by SpawnDoors, in map coordinates
     int pdirectionY = -1,pdirectionX = -1;
+    int horizontalShift = 0, verticalShift = 0; // offset of the rooms from dungeon to map coordinates (on top of the borders)
     bool isValidSpace = true;
+    // packed per row bit masks of the wall and floor tiles in map, bit (col % 64) of word (row * maskWords + col / 64)
+    // built by SpawnDoors and kept up to date by it and RemoveThinWalls
+    int maskWords = 0;
+    std::vector<uint64_t> wallMask, floorMask;
+    Stats* stats = nullptr; // not owned, Start adds to it so one Stats can sum up several levels
+    // every random number of Start comes from here, seed it for reproducible levels
+    std::mt19937 rng;
 
     Generation(int WIDTH, int HEIGHT, int borderLeft, int borderRight, int borderUp, int borderDown);
     int Start(int amountOfRooms, int minWidth, int maxWidth, int minHeight, int maxHeight);
     void TryFillOutSpacing(POS pos,std::vector<POS>& spacing);
     void OpenSpace(POS pos,std::vector<POS>& spacing);
     void SpawnDoors(int verticalShift, int horizontalShift);
+    void BuildMasks();
+    void RemoveThinWalls();
+    bool IsFloor(int row, int col) const;
+    void SetTile(int row, int col, char tile); // updates map and the masks
     void SpawnHouse(const int& minWidth, const int& maxWidth, const int& minHeight, const int& maxHeight, const POS& pos = POS());
     bool CanPlaceRoom(int x, int y, int width, int height);
-};
\ No newline at end of file
+    int Random(); // non negative like rand(), but from rng
+};
+
+#endif /* GENERATION_HPP */
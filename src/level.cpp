@@ -0,0 +1,161 @@
+#include "level.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+
+static uint64_t alignSection(uint64_t offset) {
+	return (offset + Level::SectionAlignment - 1) / Level::SectionAlignment * Level::SectionAlignment;
+}
+
+std::vector<Level::Room> Level::GetRooms(const Generation& gen) {
+	std::vector<Room> rooms;
+	rooms.reserve(gen.rooms.size());
+	for (const auto& room : gen.rooms) {
+		if (room.empty()) continue;
+
+		// NOTE: POS::x is the row and POS::y the column in Generation
+		int minRow = INT_MAX, maxRow = INT_MIN, minCol = INT_MAX, maxCol = INT_MIN;
+		for (const auto& p : room) {
+			minRow = std::min(minRow, p.x);
+			maxRow = std::max(maxRow, p.x);
+			minCol = std::min(minCol, p.y);
+			maxCol = std::max(maxCol, p.y);
+		}
+		rooms.push_back(Room{
+			minCol + gen.borderRight + gen.horizontalShift,
+			minRow + gen.borderUp + gen.verticalShift,
+			maxCol - minCol + 1,
+			maxRow - minRow + 1,
+		});
+	}
+	return rooms;
+}
+
+std::vector<Level::Door> Level::GetDoors(const Generation& gen) {
+	std::vector<Door> doors;
+	doors.reserve(gen.doors.size());
+	for (const auto& p : gen.doors) {
+		doors.push_back(Door{p.y, p.x});
+	}
+	return doors;
+}
+
+bool Level::Save(const std::string& path, const Generation& gen, const std::vector<Light>& lights, const uint8_t* bakedLight) {
+	return Save(path, TileView(gen.map), GetRooms(gen), GetDoors(gen), lights, bakedLight);
+}
+
+bool Level::Save(const std::string& path, const TileView& tiles, const std::vector<Room>& rooms, const std::vector<Door>& doors, const std::vector<Light>& lights, const uint8_t* bakedLight) {
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) return false;
+
+	const uint64_t tileBytes = (uint64_t)tiles.GetWidth() * tiles.GetHeight();
+
+	Header header{};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.width = tiles.GetWidth();
+	header.height = tiles.GetHeight();
+	header.flags = bakedLight ? Flag_BakedLight : 0;
+	header.roomCount = rooms.size();
+	header.doorCount = doors.size();
+	header.lightCount = lights.size();
+	header.tilesOffset = alignSection(sizeof(Header));
+	header.roomsOffset = alignSection(header.tilesOffset + tileBytes);
+	header.doorsOffset = alignSection(header.roomsOffset + rooms.size() * sizeof(Room));
+	header.lightsOffset = alignSection(header.doorsOffset + doors.size() * sizeof(Door));
+	header.bakedLightOffset = bakedLight ? alignSection(header.lightsOffset + lights.size() * sizeof(Light)) : 0;
+
+	uint64_t written = 0;
+	auto write = [&](const void* data, uint64_t size) {
+		out.write(static_cast<const char*>(data), size);
+		written += size;
+	};
+	auto padTo = [&](uint64_t offset) {
+		static const char zeros[SectionAlignment] {};
+		write(zeros, offset - written);
+	};
+
+	write(&header, sizeof(Header));
+
+	padTo(header.tilesOffset);
+	for (int y = 0; y < tiles.GetHeight(); y++) {
+		write(tiles[y], tiles.GetWidth());
+	}
+
+	padTo(header.roomsOffset);
+	write(rooms.data(), rooms.size() * sizeof(Room));
+	padTo(header.doorsOffset);
+	write(doors.data(), doors.size() * sizeof(Door));
+	padTo(header.lightsOffset);
+	write(lights.data(), lights.size() * sizeof(Light));
+
+	if (bakedLight) {
+		padTo(header.bakedLightOffset);
+		write(bakedLight, tileBytes * 3);
+	}
+
+	return (bool)out;
+}
+
+Level::File::File(const std::string& path) {
+	Open(path);
+}
+
+bool Level::File::Open(const std::string& path) {
+	header = nullptr;
+	if (!file.Open(path)) {
+		error = "can't map " + path;
+		return false;
+	}
+
+	const uint8_t* base = file.GetData();
+	const uint64_t size = file.GetSize();
+	const Header* h = reinterpret_cast<const Header*>(base);
+
+	if (size < sizeof(Header) || memcmp(h->magic, Magic, sizeof(Magic)) != 0) {
+		error = path + " is not a level file";
+		return false;
+	}
+	if (h->version != Version) {
+		error = path + " has level version " + std::to_string(h->version) + ", expected " + std::to_string(Version);
+		return false;
+	}
+	if (h->width <= 0 || h->height <= 0) {
+		error = path + " has an invalid size";
+		return false;
+	}
+
+	const uint64_t tileBytes = (uint64_t)h->width * h->height;
+	auto fits = [&](uint64_t offset, uint64_t bytes) {
+		return offset % SectionAlignment == 0 && offset <= size && bytes <= size - offset;
+	};
+	if (!fits(h->tilesOffset, tileBytes) ||
+		!fits(h->roomsOffset, (uint64_t)h->roomCount * sizeof(Room)) ||
+		!fits(h->doorsOffset, (uint64_t)h->doorCount * sizeof(Door)) ||
+		!fits(h->lightsOffset, (uint64_t)h->lightCount * sizeof(Light)) ||
+		((h->flags & Flag_BakedLight) && !fits(h->bakedLightOffset, tileBytes * 3))) {
+		error = path + " is truncated";
+		return false;
+	}
+
+	// NOTE: the lights index the light map straight away, one outside the level would write past it
+	const Light* fileLights = reinterpret_cast<const Light*>(base + h->lightsOffset);
+	for (uint32_t i = 0; i < h->lightCount; i++) {
+		const Light& light = fileLights[i];
+		if (light.x < 0 || light.y < 0 || light.x >= h->width || light.y >= h->height) {
+			error = path + " has a light outside the level";
+			return false;
+		}
+	}
+
+	tiles = reinterpret_cast<const char*>(base + h->tilesOffset);
+	rooms = reinterpret_cast<const Room*>(base + h->roomsOffset);
+	doors = reinterpret_cast<const Door*>(base + h->doorsOffset);
+	lights = fileLights;
+	bakedLight = (h->flags & Flag_BakedLight) ? base + h->bakedLightOffset : nullptr;
+	header = h;
+	error.clear();
+	return true;
+}
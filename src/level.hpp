@@ -0,0 +1,120 @@
+#ifndef LEVEL_HPP
+#define LEVEL_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "generation.hpp"
+#include "mappedFile.hpp"
+#include "tileView.hpp"
+
+// Binary level files
+//
+// Layout (native byte order, every section starts 64 byte aligned):
+//   Header
+//   tiles        height rows of width chars, same values as Generation::map
+//   rooms        roomCount Room
+//   doors        doorCount Door
+//   lights       lightCount Light
+//   baked light  width * height RGB triplets, only if Flag_BakedLight is set
+//
+// Everything is plain old data, so a loaded level points straight into the
+// mapped file instead of being parsed.
+namespace Level {
+
+constexpr char Magic[4] { 'B', 'L', 'V', 'L' };
+constexpr uint32_t Version = 1;
+constexpr uint64_t SectionAlignment = 64;
+
+enum Flags : uint32_t {
+	Flag_BakedLight = 1 << 0,
+};
+
+struct Header {
+	char magic[4];
+	uint32_t version;
+	int32_t width;
+	int32_t height;
+	uint32_t flags;
+	uint32_t roomCount;
+	uint32_t doorCount;
+	uint32_t lightCount;
+	uint64_t tilesOffset;
+	uint64_t roomsOffset;
+	uint64_t doorsOffset;
+	uint64_t lightsOffset;
+	uint64_t bakedLightOffset;
+};
+
+// bounding box of a room in map tiles
+struct Room {
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+};
+
+struct Door {
+	int32_t x;
+	int32_t y;
+};
+
+struct Light {
+	int32_t x;
+	int32_t y;
+	uint8_t r;
+	uint8_t g;
+	uint8_t b;
+	uint8_t padding{0};
+	float dropOff;
+};
+
+// Streams a level to disk section by section, without building it in memory first.
+// bakedLight is optional and has to hold width * height RGB triplets, row by row.
+bool Save(const std::string& path, const Generation& gen, const std::vector<Light>& lights = {}, const uint8_t* bakedLight = nullptr);
+bool Save(const std::string& path, const TileView& tiles, const std::vector<Room>& rooms, const std::vector<Door>& doors, const std::vector<Light>& lights = {}, const uint8_t* bakedLight = nullptr);
+
+std::vector<Room> GetRooms(const Generation& gen);
+std::vector<Door> GetDoors(const Generation& gen);
+
+// A level mapped into memory
+class File {
+public:
+	File() = default;
+	File(const std::string& path);
+
+	// Maps the file and validates the header, on failure GetError() tells why
+	bool Open(const std::string& path);
+
+	inline bool IsOpen() const { return header != nullptr; }
+	inline const std::string& GetError() const { return error; }
+
+	inline int GetWidth() const { return header->width; }
+	inline int GetHeight() const { return header->height; }
+	inline const char* GetRow(int y) const { return tiles + y * header->width; }
+	inline char GetTile(int x, int y) const { return tiles[x + y * header->width]; }
+	inline TileView GetTiles() const { return TileView(tiles, header->width, header->height, header->width); }
+
+	inline int GetRoomCount() const { return header->roomCount; }
+	inline const Room* GetRooms() const { return rooms; }
+	inline int GetDoorCount() const { return header->doorCount; }
+	inline const Door* GetDoors() const { return doors; }
+	inline int GetLightCount() const { return header->lightCount; }
+	inline const Light* GetLights() const { return lights; }
+	// nullptr if the level has no baked light
+	inline const uint8_t* GetBakedLight() const { return bakedLight; }
+
+private:
+	MappedFile file;
+	std::string error;
+	const Header* header{nullptr};
+	const char* tiles{nullptr};
+	const Room* rooms{nullptr};
+	const Door* doors{nullptr};
+	const Light* lights{nullptr};
+	const uint8_t* bakedLight{nullptr};
+};
+
+}
+
+#endif /* LEVEL_HPP */
@@ -6,12 +6,15 @@
 #include <sstream>
 #include <queue>
 #include <cstdlib>
+#include <mutex>
 
 #if __has_include("SDL2/SDL.h")
 #include <SDL2/SDL.h>
 #else
 #include <SDL.h>
 #endif
+#include "profiler.hpp"
+#define CIDR_PROFILE_ZONE(name) PROFILE_ZONE(name)
 #define CIDR_IMPLEMENTATION
 #include "cidr.hpp"
 using namespace cdr;
@@ -19,7 +22,14 @@ using namespace cdr;
 #include "display.hpp"
 #include "eventHandler.hpp"
 #include "timer.hpp"
+#include "frameStats.hpp"
+#include "assetLoader.hpp"
+#include "textureCache.hpp"
+#include "gameLoop.hpp"
 #include "generation.hpp"
+#include "level.hpp"
+#include "tileView.hpp"
+#include "world.hpp"
 
 int linesCount = 0;
 int windowWidth;
@@ -51,6 +61,8 @@ private:
 	std::vector<std::vector<Light>> lightMap;
 	std::queue<LightNode> lightBfsQueue[3]; // 3 channels -> r g b
 	std::queue<LightNode> lightRemovalBfsQueue[3];
+	// tiles the light propagates through
+	TileView tiles{gen.map};
 
 	void setLightChannel(int x, int y, uint8_t val, int channel) { 
 		if (channel == 0) {
@@ -79,6 +91,32 @@ public:
 		}
 	}
 
+	// Lets the light run over another tile grid than gen.map, e.g. a mapped
+	// level or the resident chunks of a World copied out with World::CopyRegion.
+	// The light map takes the size of the grid, a grid of another size starts out dark.
+	void SetTiles(const TileView& tiles) {
+		this->tiles = tiles;
+		if (tiles.GetWidth() == width && tiles.GetHeight() == height) return;
+		width = tiles.GetWidth();
+		height = tiles.GetHeight();
+		lightMap.assign(width, std::vector<Light>(height));
+		for (int channel = 0; channel < 3; channel++) {
+			lightBfsQueue[channel] = {};
+			lightRemovalBfsQueue[channel] = {};
+		}
+	}
+	// Seeds the light values from width * height RGB triplets, row by row
+	void SetBakedLight(const uint8_t* rgb) {
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				const uint8_t* texel = rgb + (x + y * width) * 3;
+				lightMap[x][y].r = texel[0];
+				lightMap[x][y].g = texel[1];
+				lightMap[x][y].b = texel[2];
+			}
+		}
+	}
+
 	void SetLightSource(int x, int y, uint8_t r, uint8_t g, uint8_t b, float dropOff) {
 		lightMap[x][y] = {r, g, b, dropOff};
 		lightBfsQueue[0].emplace(LightNode{x, y, (float)r, dropOff});
@@ -104,14 +142,25 @@ public:
 			return lightMap[x][y].b;
 		}
 	}
+	// Copies the light values row by row into width * height lights
+	void CopyTo(std::vector<Light>& lights) const {
+		lights.resize(width * height);
+		for (int x = 0; x < width; x++) {
+			for (int y = 0; y < height; y++) {
+				lights[x + y * width] = lightMap[x][y];
+			}
+		}
+	}
 	// float GetNormalizedLight(int x, int y) {
 	// 	return lightMap[x][y] / 255.f;
 	// }
 
 	void Update() {
+		PROFILE_ZONE("LightMap::Update");
 		for (int channel = 0; channel < 3; channel++) {
+			PROFILE_ZONE("light removal");
 			while (!lightRemovalBfsQueue[channel].empty()) {
-				LightNode& node = lightRemovalBfsQueue[channel].front();
+				LightNode node = lightRemovalBfsQueue[channel].front();
 				float currentLightLevel = node.light;
 				lightRemovalBfsQueue[channel].pop();
 
@@ -143,10 +192,11 @@ public:
 		}
 
 		for (int channel = 0; channel < 3; channel++) {
+			PROFILE_ZONE("light addition");
 			while (!lightBfsQueue[channel].empty()) {
-				LightNode& node = lightBfsQueue[channel].front();
+				LightNode node = lightBfsQueue[channel].front();
 				lightBfsQueue[channel].pop();
-				float currentLightLevel = (gen.map[node.y][node.x] != '#') * GetLightChannel(node.x, node.y, channel);
+				float currentLightLevel = (tiles[node.y][node.x] != '#') * GetLightChannel(node.x, node.y, channel);
 				float dropoff = 0.6f; // TODO: this should be part of a light node
 
 				if (currentLightLevel < 10) {
@@ -271,69 +321,313 @@ void removeLight(int x, int y, int lightLevel = maxLight) {
 
 #define applyLight applyLightCircular
 #define removeLight removeLightCircular
+// generator tiles to what the renderer and the light expect: nothing, walls and floor
+void prepareTiles(std::vector<std::string>& map) {
+	for (std::string& row : map) {
+		for (char& current : row) {
+			if (current == '-') {
+				current = ' ';
+			} else if (current != '#') {
+				current = '.';
+			}
+		}
+	}
+}
 cdr::RGB getRandColor() {
 	uint8_t randNumber = rand() % 128 + 127;
 	return RGB(randNumber, randNumber, randNumber);
   return RGB(randNumber, randNumber, randNumber);
 }
 int main(int argc, char** argv) {
-	SDL_Init(SDL_INIT_EVERYTHING);
-
 	float zoom{1};
-	if(argc >= 3) {
-		windowWidth = std::stoi(argv[1]);
-		windowHeight = std::stoi(argv[2]);
-		if(argc >= 4) {
-			pixelSize = std::stoi(argv[3]);
+	std::string levelPath;
+	std::string saveLevelPath;
+	bool useWorld = false;
+	bool threadedPresent = false;
+	bool streaming = false;
+	bool headless = false;
+	bool dirtyRects = false;
+	bool showStats = false;
+	bool simThread = false;
+	double simRate = 60;
+	std::string tracePath;
+	std::string recordPath;
+	std::string replayPath;
+	std::string wallTexturePath;
+	std::string textureCachePath;
+	double targetFps = 0;
+	long long frameLimit = -1;
+	std::string dumpPath;
+	Display::DumpFormat dumpFormat{};
+	std::vector<std::string> args;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--level" && i + 1 < argc) {
+			levelPath = argv[++i];
+		} else if (arg == "--save-level" && i + 1 < argc) {
+			saveLevelPath = argv[++i];
+		} else if (arg == "--world") {
+			useWorld = true;
+		} else if (arg == "--threaded-present") {
+			threadedPresent = true;
+		} else if (arg == "--streaming") {
+			streaming = true;
+		} else if (arg == "--dirty-rects") {
+			dirtyRects = true;
+		} else if (arg == "--fps" && i + 1 < argc) {
+			targetFps = std::stod(argv[++i]);
+		} else if (arg == "--trace" && i + 1 < argc) {
+			tracePath = argv[++i];
+		} else if (arg == "--record" && i + 1 < argc) {
+			recordPath = argv[++i];
+		} else if (arg == "--replay" && i + 1 < argc) {
+			replayPath = argv[++i];
+		} else if (arg == "--wall-texture" && i + 1 < argc) {
+			wallTexturePath = argv[++i];
+		} else if (arg == "--texture-cache" && i + 1 < argc) {
+			textureCachePath = argv[++i];
+		} else if (arg == "--sim-rate" && i + 1 < argc) {
+			simRate = std::stod(argv[++i]);
+		} else if (arg == "--sim-thread") {
+			simThread = true;
+		} else if (arg == "--stats") {
+			showStats = true;
+		} else if (arg == "--headless") {
+			headless = true;
+		} else if (arg == "--frames" && i + 1 < argc) {
+			frameLimit = std::stoll(argv[++i]);
+		} else if (arg == "--dump-raw" && i + 1 < argc) {
+			dumpPath = argv[++i];
+			dumpFormat = Display::DumpFormat::Raw;
+		} else if (arg == "--dump-png" && i + 1 < argc) {
+			dumpPath = argv[++i];
+			dumpFormat = Display::DumpFormat::PNG;
+		} else if (arg == "--dump-y4m" && i + 1 < argc) {
+			dumpPath = argv[++i];
+			dumpFormat = Display::DumpFormat::Y4M;
+		} else {
+			args.push_back(arg);
+		}
+	}
+	// NOTE: headless runs don't need a video device, only events for the EventHandler
+	SDL_Init(headless ? SDL_INIT_EVENTS | SDL_INIT_TIMER : SDL_INIT_EVERYTHING);
+
+	pixelSize = 16;
+	if(args.size() >= 2) {
+		windowWidth = std::stoi(args[0]);
+		windowHeight = std::stoi(args[1]);
+		if(args.size() >= 3) {
+			pixelSize = std::stoi(args[2]);
 		}
 	} else {
-		pixelSize = 16;
 		windowWidth = 800/pixelSize*pixelSize;
 		windowHeight = 600/pixelSize*pixelSize;
 	}
+
+	// a cached texture is mapped instead of decoded, mips included
+	TextureCache::File wallCache;
+	if (!wallTexturePath.empty() && !textureCachePath.empty()) {
+		TextureCache::Builder textureCache(textureCachePath, TextureCache::Validation::Mtime, true);
+		if (!textureCache.Open(wallTexturePath, wallCache)) {
+			std::cerr << "Can't cache the wall texture: " << textureCache.GetError() << std::endl;
+		}
+	}
+	// NOTE: decodes while the level gets generated or loaded and the lights are set up,
+	// the mips keep textures that are bigger than a tile from aliasing
+	AssetLoader assets(0, AssetLoader::DefaultCacheBytes, true);
+	AssetLoader::Handle wallTexture;
+	if (!wallTexturePath.empty() && !wallCache.IsOpen()) {
+		wallTexture = assets.Load(wallTexturePath);
+	}
+
+	// a prebuilt level decides the canvas size
+	Level::File level;
+	if (!levelPath.empty()) {
+		if (!level.Open(levelPath)) {
+			std::cerr << "Failed to load level: " << level.GetError() << std::endl;
+			return 1;
+		}
+		windowWidth = level.GetWidth() * pixelSize;
+		windowHeight = level.GetHeight() * pixelSize;
+	}
+
 	gen = Generation(windowWidth/pixelSize,windowHeight/pixelSize,4,4,4,4);
 	LightMap lm(windowWidth/pixelSize, windowHeight/pixelSize);
 
-	Display display(windowWidth, windowHeight, "Basic Lighting", true, false, zoom, zoom);
-	Renderer renderer{display.GetPixels(), display.GetCanvasWidth(), display.GetCanvasHeight()};
+	Display display(windowWidth, windowHeight, "Basic Lighting", true, false, zoom, zoom, headless ? Display::Backend::Headless : Display::Backend::Window);
+	if (!dumpPath.empty() && !display.DumpFrames(dumpPath, dumpFormat, targetFps > 0 ? targetFps : 60)) {
+		std::cerr << "Can't dump frames to " << dumpPath << std::endl;
+		return 1;
+	}
+	// NOTE: streaming is opt in, the mask, the blending and frame dumps read the frame back,
+	// which is slow from the write combined memory of a locked texture
+	if (threadedPresent) {
+		display.SetThreadedPresent(true);
+	} else if (streaming) {
+		display.SetStreaming(true);
+	}
+	// NOTE: the display hands out a different buffer when it's resized, streaming or presenting on another thread
+	Renderer renderer{display.GetPixels(), display.GetCanvasWidth(), display.GetCanvasHeight(), display.GetPitch()};
+	display.AddFramebufferListener([&](uint32_t* pixels, int width, int height, int pitch) {
+		renderer.SetTarget(pixels, width, height, pitch);
+	});
+	if (dirtyRects) {
+		// the renderer reports what it drew, the light compositing included (ApplyMask),
+		// the display uploads only that. The demo repaints everything, so it's a full upload
+		// every frame here, scenes that mostly stay the same get the savings.
+		renderer.EnableDamageTracking();
+		display.SetDirtyTracking(true);
+	}
 
 	auto duration = std::chrono::system_clock::now().time_since_epoch();
-	auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
-	srand(millis);
-	gen.Start(8,6,8,6,8);
-	lightMap.resize(gen.WIDTH);
-	for (int i = 0; i < gen.WIDTH; i++) {
-		lightMap[i].resize(gen.HEIGHT);
-	}
-	for(int i = 0; i < gen.WIDTH; i++) {
-		for(int j = 0; j < gen.HEIGHT; j++) {
-			char& current = gen.map[j][i];
-			if (current == '-') {
-				current = ' ';
-			} else if (current != '#') {
-				current = '.';
-			}
+	uint64_t seed = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+	// a replay has to generate the same level and walls as the recording
+	if (!replayPath.empty()) {
+		if (!EventHandler::StartReplay(replayPath)) {
+			std::cerr << "Can't replay " << replayPath << std::endl;
+			return 1;
 		}
+		seed = EventHandler::GetReplaySeed();
+	} else if (!recordPath.empty() && !EventHandler::StartRecording(recordPath, seed)) {
+		std::cerr << "Can't record to " << recordPath << std::endl;
+		return 1;
 	}
-	for(int x = 0; x < gen.WIDTH; x++) {
-		for(int y = 0; y < gen.HEIGHT; y++) {
-			char& current = gen.map[y][x];
-			if (current == 'P') {
-				applyLight(x, y, maxLight);
+	srand(seed);
+	TileView tiles;
+	std::vector<std::string> worldMap;
+	if (level.IsOpen()) {
+		// NOTE: the tiles stay in the mapped file, nothing gets generated or parsed
+		tiles = level.GetTiles();
+		lm.SetTiles(tiles);
+		if (level.GetBakedLight()) {
+			lm.SetBakedLight(level.GetBakedLight());
+		}
+		for (int i = 0; i < level.GetLightCount(); i++) {
+			const Level::Light& light = level.GetLights()[i];
+			lm.SetLightSource(light.x, light.y, light.r, light.g, light.b, light.dropOff);
+		}
+	} else if (useWorld) {
+		// the part of the endless world under the canvas, made out of the chunks around its centre
+		int width = windowWidth / pixelSize;
+		int height = windowHeight / pixelSize;
+		int radius = std::max(width, height) / (2 * World::ChunkSize) + 1;
+		World world(seed, std::max(64, (2 * radius + 1) * (2 * radius + 1)));
+		world.Update(width / 2, height / 2, radius, radius);
+		world.CopyRegion(0, 0, width, height, worldMap);
+		prepareTiles(worldMap);
+		tiles = TileView(worldMap);
+		lm.SetTiles(tiles);
+	} else {
+		gen.rng.seed(seed);
+		gen.Start(8,6,8,6,8);
+		lightMap.resize(gen.WIDTH);
+		for (int i = 0; i < gen.WIDTH; i++) {
+			lightMap[i].resize(gen.HEIGHT);
+		}
+		// the players carry a light in saved levels, prepareTiles turns them into floor
+		std::vector<Level::Light> playerLights;
+		if (!saveLevelPath.empty()) {
+			for (int y = 0; y < gen.HEIGHT; y++) {
+				for (int x = 0; x < gen.WIDTH; x++) {
+					if (gen.map[y][x] == Generation::Tile_Player) {
+						playerLights.push_back({x, y, 255, 255, 255, 0, 0.75f});
+					}
+				}
 			}
 		}
+		prepareTiles(gen.map);
+		// NOTE: saved with the tiles as they get rendered, the player lights only light it up once loaded with --level
+		if (!saveLevelPath.empty() && !Level::Save(saveLevelPath, gen, playerLights)) {
+			std::cerr << "Failed to save level to " << saveLevelPath << std::endl;
+		}
+		tiles = TileView(gen.map);
+	}
+
+	if (EventHandler::IsRecording() || EventHandler::IsReplaying()) {
+		// replays have to draw the same frames, no matter how fast the texture got decoded
+		wallTexture.Wait();
 	}
 
 	bool smooth = true;
-	int current = SDL_GetTicks();
-	int old = 0;
-	int elapsed = 0;
+	FrameStats frameStats;
+	frameStats.SetTargetFps(targetFps);
+	if (!tracePath.empty()) {
+		Profiler::SetThreadName("main");
+		Profiler::Start();
+	}
 
-	while (!display.IsClosed()) {
-		elapsed = current - old;
-		old = current;
-		current = SDL_GetTicks();
-		std::cout << "ms: " << elapsed << std::endl;
+	// The lights are simulated at a fixed tick and handed to the renderer as snapshots of the last
+	// two ticks, which get interpolated. Input turns into edits that the next tick applies.
+	struct LightEdit {
+		int x{0};
+		int y{0};
+		bool remove{false};
+		uint8_t r{0};
+		uint8_t g{0};
+		uint8_t b{0};
+	};
+	struct LightSnapshot {
+		std::vector<LightMap::Light> previous;
+		std::vector<LightMap::Light> current;
+		double time{0};
+	};
+	std::mutex editMutex;
+	std::vector<LightEdit> edits;
+	std::vector<LightEdit> tickEdits;
+	std::vector<LightMap::Light> lastLights;
+	TripleBuffer<LightSnapshot> snapshots;
+	GameLoop loop(1.0 / std::max(simRate, 1.0));
+
+	auto publishSnapshot = [&]() {
+		LightSnapshot& snapshot = snapshots.Back();
+		lm.CopyTo(snapshot.current);
+		snapshot.previous = lastLights.empty() ? snapshot.current : lastLights;
+		snapshot.time = loop.GetSimulationTime();
+		lastLights = snapshot.current;
+		snapshots.Publish();
+	};
+	float pulse = 0;
+	loop.SetSimulation([&](double tickSeconds) {
+		PROFILE_ZONE("tick");
+		{
+			std::lock_guard<std::mutex> lock(editMutex);
+			tickEdits.swap(edits);
+		}
+		for (const LightEdit& edit : tickEdits) {
+			if (edit.remove) {
+				lm.RemoveLightSource(edit.x, edit.y);
+			} else {
+				lm.SetLightSource(edit.x, edit.y, edit.r, edit.g, edit.b, 0.8);
+			}
+		}
+		tickEdits.clear();
+
+		pulse += tickSeconds;
+		int clr = (std::sin(pulse)+1)/2.f*255;
+		// NOTE: a loaded level can be smaller than where the pulsing lights sit
+		auto pulseLight = [&](int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+			if (x >= lm.width || y >= lm.height) return;
+			lm.RemoveLightSource(x, y);
+			lm.SetLightSource(   x, y, r, g, b, 0.75f);
+		};
+		pulseLight(20+4, 20-4, clr, 0, 0);
+		pulseLight(21+4, 21-3, 0, clr, 0);
+		pulseLight(19+4, 21-3, 0, 0, clr);
+
+		// update light
+		lm.Update();
+		publishSnapshot();
+	});
+	lm.Update();
+	publishSnapshot();
+	if (simThread) {
+		// NOTE: not deterministic, replays only match without the simulation thread
+		loop.StartThread();
+	}
+
+	while (!display.IsClosed() && (frameLimit < 0 || (long long)display.GetFrameCount() < frameLimit)) {
+		frameStats.Tick();
+		PROFILE_ZONE("frame");
 
 		if (EventHandler::IsKeyDown(SDL_SCANCODE_C) && EventHandler::IsKeyDown(SDL_SCANCODE_LCTRL)) {
 			display.Abort();
@@ -351,39 +645,43 @@ int main(int argc, char** argv) {
 		if (EventHandler::IsKeyDown(SDL_SCANCODE_W)) {
 			color = 8;
 		}
+		auto queueEdit = [&](const LightEdit& edit) {
+			std::lock_guard<std::mutex> lock(editMutex);
+			// a button that's held down doesn't queue the same edit for every frame between two ticks
+			const LightEdit* last = edits.empty() ? nullptr : &edits.back();
+			if (last && last->x == edit.x && last->y == edit.y && last->remove == edit.remove) return;
+			edits.push_back(edit);
+		};
 		if (EventHandler::IsLeftMouseDown()) {
 			int mx = EventHandler::GetMouseX() / pixelSize;
 			int my = EventHandler::GetMouseY() / pixelSize;
-			// if (mouseX != newMouseX || mouseY != newMouseY) {
-			// 	mouseX = newMouseX;
-			// 	mouseY = newMouseY;
-			// 	lm.SetLightSource(newMouseX, newMouseY, 255);
-			// }
-			lm.SetLightSource(mx, my, (color & 1 || color >> 3) * 255, ((color >> 1) & 1 || color >> 3) * 255, ((color >> 2) & 1 || color >> 3) * 255, 0.8);
+			queueEdit({mx, my, false, uint8_t((color & 1 || color >> 3) * 255), uint8_t(((color >> 1) & 1 || color >> 3) * 255), uint8_t(((color >> 2) & 1 || color >> 3) * 255)});
 		}
 		if (EventHandler::IsRightMouseDown()) {
 			int mx = EventHandler::GetMouseX() / pixelSize;
 			int my = EventHandler::GetMouseY() / pixelSize;
-			// if (mouseX != newMouseX || mouseY != newMouseY) {
-			// 	mouseX = newMouseX;
-			// 	mouseY = newMouseY;
-			// 	lm.RemoveLightSource(newMouseX, newMouseY);
-			// }
-			lm.RemoveLightSource(mx, my);
+			queueEdit({mx, my, true});
 		}
 		if (EventHandler::IsKeyPressed(SDL_SCANCODE_S)) {
 			smooth = !smooth;
 		}
+		if (EventHandler::IsKeyPressed(SDL_SCANCODE_F)) {
+			showStats = !showStats;
+		}
 
-		static float pulse = 0;
-		pulse += elapsed/1000.f;
-		int clr = (std::sin(pulse)+1)/2.f*255;
-		lm.RemoveLightSource(20+4, 20-4);
-		lm.SetLightSource(   20+4, 20-4, clr, 0, 0, 0.75f);
-		lm.RemoveLightSource(21+4, 21-3);
-		lm.SetLightSource(   21+4, 21-3, 0, clr, 0, 0.75f);
-		lm.RemoveLightSource(19+4, 21-3);
-		lm.SetLightSource(   19+4, 21-3, 0, 0, clr, 0.75f);
+		// NOTE: the recorded frame time while replaying, so every frame runs the same ticks
+		loop.Advance(EventHandler::GetFrameSeconds());
+		const LightSnapshot& snapshot = snapshots.Acquire();
+		float alpha = loop.GetAlpha(snapshot.time);
+		auto lightAt = [&](int x, int y) {
+			const LightMap::Light& from = snapshot.previous[x + y * lm.width];
+			const LightMap::Light& to = snapshot.current[x + y * lm.width];
+			LightMap::Light light = to;
+			light.r = from.r + (to.r - from.r) * alpha;
+			light.g = from.g + (to.g - from.g) * alpha;
+			light.b = from.b + (to.b - from.b) * alpha;
+			return light;
+		};
 
 		renderer.Clear();
 
@@ -400,83 +698,148 @@ int main(int argc, char** argv) {
 		// 	}
 		// }
 
-		// update light
-		lm.Update();
-
-		Bitmap absoluteShadowMask(windowWidth, windowHeight);
-		Renderer absoluteShadowMask_rend(absoluteShadowMask.GetData(), absoluteShadowMask.GetWidth(), absoluteShadowMask.GetHeight());
+		// the masks have the size of the canvas, which doesn't have to match the level after a resize
+		int levelWidth = std::min(tiles.GetWidth() * pixelSize, renderer.GetWidth());
+		int levelHeight = std::min(tiles.GetHeight() * pixelSize, renderer.GetHeight());
+		// NOTE: canvas sized bitmaps get aligned rows
+		Bitmap absoluteShadowMask(renderer.GetWidth(), renderer.GetHeight(), BitmapInit::Zero, Bitmap::AlignedPitch(renderer.GetWidth()));
+		Renderer absoluteShadowMask_rend(absoluteShadowMask);
 
 		// Mask
-		Bitmap mask_shadow(windowWidth / pixelSize, windowHeight / pixelSize);
+		// NOTE: every pixel of the shadow mask gets set below
+		Bitmap mask_shadow(windowWidth / pixelSize, windowHeight / pixelSize, BitmapInit::None);
 		Bitmap mask_empty(windowWidth / pixelSize, windowHeight / pixelSize);
 		Bitmap mask_wall(windowWidth / pixelSize, windowHeight / pixelSize);
-		for (int x = 0; x < mask_shadow.GetWidth(); x++) {
-			for (int y = 0; y < mask_shadow.GetHeight(); y++) {
-				// float lightVal = GetNormalizedLight(x, y);
-				const LightMap::Light& light = lm.GetLightValue(x, y);
-				mask_shadow.SetPixel({light.r, light.g, light.b}, x, y);
-
-				if (gen.map[y][x] == '#') {
-					mask_wall.SetPixel({light.r, light.g, light.b}, x, y);
-				} else {
-					mask_empty.SetPixel({light.r, light.g, light.b}, x, y);
-				}
+		{
+			PROFILE_ZONE("mask build");
+			for (int x = 0; x < mask_shadow.GetWidth(); x++) {
+				for (int y = 0; y < mask_shadow.GetHeight(); y++) {
+					// float lightVal = GetNormalizedLight(x, y);
+					LightMap::Light light = lightAt(x, y);
+					mask_shadow.SetPixel({light.r, light.g, light.b}, x, y);
+
+					if (tiles[y][x] == '#') {
+						mask_wall.SetPixel({light.r, light.g, light.b}, x, y);
+					} else {
+						mask_empty.SetPixel({light.r, light.g, light.b}, x, y);
+					}
 
-				uint32_t maskR = (light.r > 0)*0xFF000000;
-				uint32_t maskG = (light.g > 0)*0x00FF0000;
-				uint32_t maskB = (light.b > 0)*0x0000FF00;
-				uint32_t mask = maskR + maskB + maskG + 0xff;
-				// std::cout << std::hex << mask << '\n';
-				absoluteShadowMask_rend.FillRectangle(mask, x * pixelSize, y * pixelSize, pixelSize, pixelSize);
+					uint32_t maskR = (light.r > 0)*0xFF000000;
+					uint32_t maskG = (light.g > 0)*0x00FF0000;
+					uint32_t maskB = (light.b > 0)*0x0000FF00;
+					uint32_t mask = maskR + maskB + maskG + 0xff;
+					// std::cout << std::hex << mask << '\n';
+					absoluteShadowMask_rend.FillRectangle(mask, x * pixelSize, y * pixelSize, pixelSize, pixelSize);
+				}
 			}
 		}
 
 		// Shadow map
-		Bitmap shadowMap(windowWidth, windowHeight);
-		Renderer shadowMap_rend(shadowMap.GetData(), shadowMap.GetWidth(), shadowMap.GetHeight());
+		Bitmap shadowMap(renderer.GetWidth(), renderer.GetHeight(), BitmapInit::Zero, Bitmap::AlignedPitch(renderer.GetWidth()));
+		Renderer shadowMap_rend(shadowMap);
 		if (smooth) shadowMap_rend.ScaleType = Renderer::ScaleType::Linear;
-		shadowMap_rend.DrawBitmap(mask_shadow, 0, 0, shadowMap.GetWidth(), shadowMap.GetHeight(), 0, 0, mask_shadow.GetWidth(), mask_shadow.GetHeight());
+		{
+			PROFILE_ZONE("upscale");
+			shadowMap_rend.DrawBitmap(mask_shadow, 0, 0, tiles.GetWidth() * pixelSize, tiles.GetHeight() * pixelSize, 0, 0, mask_shadow.GetWidth(), mask_shadow.GetHeight());
+		}
 
 		shadowMap_rend.ApplyMask(absoluteShadowMask);
 
 		// renderer.DrawBitmap(shadowMap, 0, 0, shadowMap.GetWidth(), shadowMap.GetHeight(), 0, 0, shadowMap.GetWidth(), shadowMap.GetHeight());
 
-		for(int x = 0; x < gen.WIDTH; x++) {
-			for(int y = 0; y < gen.HEIGHT; y++) {
-				char current = gen.map[y][x];
-				RGB color;
-
-				for (int px = 0; px < pixelSize; px++) {
-					for (int py = 0; py < pixelSize; py++) {
-						if (current == '#') {
-							color = getRandColor();
-						} else {
-							color = RGB::White;
+		{
+			PROFILE_ZONE("tile draw");
+			if (wallTexture.IsFailed()) {
+				std::cerr << "Can't load the wall texture: " << wallTexture.GetError() << std::endl;
+				wallTexture = {};
+			}
+			// the walls are drawn like before until the texture is decoded
+			BitmapView wallBitmap;
+			if (wallCache.IsOpen()) {
+				wallBitmap = wallCache.GetView();
+			} else if (wallTexture.IsReady()) {
+				wallBitmap = *wallTexture.Get();
+			}
+			for(int x = 0; x < tiles.GetWidth(); x++) {
+				for(int y = 0; y < tiles.GetHeight(); y++) {
+					char current = tiles[y][x];
+					if (current == '#' && wallBitmap.GetData()) {
+						renderer.DrawBitmap(wallBitmap, x * pixelSize, y * pixelSize, pixelSize, pixelSize, 0, 0, wallBitmap.GetWidth(), wallBitmap.GetHeight());
+						continue;
+					}
+					RGB color;
+
+					for (int px = 0; px < pixelSize && x*pixelSize + px < levelWidth; px++) {
+						for (int py = 0; py < pixelSize && y*pixelSize + py < levelHeight; py++) {
+							if (current == '#') {
+								color = getRandColor();
+							} else {
+								color = RGB::White;
+							}
+							// std::cout << "px: " << px << std::endl;
+							// std::cout << "py: " << py << std::endl;
+							renderer.DrawPixel(color, x*pixelSize + px, y*pixelSize + py);
 						}
-						// std::cout << "px: " << px << std::endl;
-						// std::cout << "py: " << py << std::endl;
-						renderer.DrawPixel(color, x*pixelSize + px, y*pixelSize + py);
 					}
-				}
 				
-				// renderer.FillRectangle(color, x * pixelSize, y * pixelSize, pixelSize, pixelSize);
+					// renderer.FillRectangle(color, x * pixelSize, y * pixelSize, pixelSize, pixelSize);
+				}
 			}
 		}
 
 		renderer.ApplyMask(shadowMap);
 
 
-		for(int x = 0; x < gen.WIDTH; x++) {
-			for(int y = 0; y < gen.HEIGHT; y++) {
-				char current = gen.map[y][x];
-				if (current == '#') {
+		for(int x = 0; x < tiles.GetWidth(); x++) {
+			for(int y = 0; y < tiles.GetHeight(); y++) {
+				char current = tiles[y][x];
+				if (current == '#' && x * pixelSize + pixelSize/2 < levelWidth && y * pixelSize + pixelSize/2 < levelHeight) {
 					renderer.DrawPixel(RGB::Blue, x * pixelSize + pixelSize/2, y * pixelSize + pixelSize/2);
 				}
 			}
 		}
 
 
+		if (showStats) {
+			frameStats.DrawOverlay(renderer);
+		}
+
+		if (display.IsDirtyTracking()) {
+			for (const Rectangle& rect : renderer.GetDamage()) {
+				display.AddDirtyRect(rect.x, rect.y, rect.width, rect.height);
+			}
+			renderer.ClearDamage();
+		}
 		display.Update();
+		{
+			PROFILE_ZONE("pace");
+			frameStats.Pace();
+		}
+	}
+
+	loop.StopThread();
+	display.StopDumping();
+	EventHandler::StopRecording();
+	EventHandler::StopReplay();
+
+	if (!tracePath.empty()) {
+		Profiler::Stop();
+		if (!Profiler::WriteChromeTrace(tracePath)) {
+			std::cerr << "Can't write the trace to " << tracePath << std::endl;
+		}
+	}
+
+	// NOTE: stdout might be the raw frame stream
+	std::ostream& out = dumpPath == "-" ? std::cerr : std::cout;
+	out << frameStats.Format() << std::endl;
+	PixelAllocatorStats pixelStats = GetPixelAllocator().GetStats();
+	out << "bitmaps " << pixelStats.allocations << " (" << pixelStats.systemAllocations << " allocated)" << std::endl;
+	if (!dumpPath.empty()) {
+		FrameCapture::Stats captureStats = display.GetCapture().GetStats();
+		out << "frames dumped " << captureStats.written << ", dropped " << captureStats.dropped << std::endl;
+		if (!display.GetCapture().GetError().empty()) {
+			std::cerr << "Dumping frames failed: " << display.GetCapture().GetError() << std::endl;
+		}
 	}
 
 	SDL_Quit();
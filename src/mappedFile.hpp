@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read only memory mapping of a whole file
+class MappedFile {
+public:
+	MappedFile() = default;
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	inline bool IsOpen() const { return data != nullptr; }
+	inline const uint8_t* GetData() const { return data; }
+	inline size_t GetSize() const { return size; }
+
+private:
+	const uint8_t* data{nullptr};
+	size_t size{0};
+#ifdef _WIN32
+	void* fileHandle{nullptr};
+	void* mappingHandle{nullptr};
+#endif
+};
+
+#endif /* MAPPEDFILE_HPP */
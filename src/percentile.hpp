@@ -0,0 +1,14 @@
+#ifndef PERCENTILE_HPP
+#define PERCENTILE_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+// Nearest rank percentile of `count` ascending sorted values, p in [0, 1].
+// count has to be at least 1.
+inline double NearestRank(const double* sorted, size_t count, double p) {
+	size_t i = (size_t)(p * count + 0.5);
+	return sorted[std::min(std::max<size_t>(i, 1), count) - 1];
+}
+
+#endif /* PERCENTILE_HPP */
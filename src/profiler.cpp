@@ -0,0 +1,206 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef PROFILER_USE_RDTSC
+# ifdef _MSC_VER
+#  include <intrin.h>
+# else
+#  include <x86intrin.h>
+# endif
+#endif
+
+namespace {
+
+struct Event {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+	uint32_t depth;
+};
+
+// events are stored in blocks that never move, so they can be read while the thread records more
+constexpr size_t EventsPerBlock = 4096;
+constexpr size_t BlockCount = (Profiler::MaxEventsPerThread + EventsPerBlock - 1) / EventsPerBlock;
+
+struct ThreadBuffer {
+	// NOTE: only the owning thread writes events, it publishes them by bumping count
+	// after writing, so the trace writer reads the first count events without a lock
+	std::unique_ptr<Event[]> blocks[BlockCount];
+	std::atomic<size_t> count{0};
+	std::atomic<uint64_t> capture{0};
+	std::mutex nameMutex;
+	std::string name;
+	uint32_t id;
+	uint32_t depth{0};
+	bool exited{false};
+};
+
+std::atomic<bool> capturing{false};
+std::atomic<uint64_t> capture{0};
+
+// buffers outlive their threads until their events can't be written anymore,
+// i.e. until the next Start() or right away if they have none for this capture
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+uint32_t nextThreadId{1};
+
+void removeBuffer(const ThreadBuffer* buffer) {
+	buffers.erase(std::find_if(buffers.begin(), buffers.end(), [&](const auto& b) { return b.get() == buffer; }));
+}
+
+// hands the buffer back to the registry when its thread exits
+struct BufferOwner {
+	ThreadBuffer* buffer{nullptr};
+
+	~BufferOwner() {
+		if (!buffer) return;
+		std::lock_guard<std::mutex> lock(registryMutex);
+		buffer->exited = true;
+		if (buffer->capture != capture || buffer->count == 0) {
+			removeBuffer(buffer);
+		}
+	}
+};
+
+// the clock at Start(), to convert ticks to microseconds
+uint64_t startTicks{0};
+std::chrono::steady_clock::time_point startTime;
+
+ThreadBuffer& threadBuffer() {
+	thread_local BufferOwner owner;
+	if (!owner.buffer) {
+		std::lock_guard<std::mutex> lock(registryMutex);
+		buffers.push_back(std::make_unique<ThreadBuffer>());
+		owner.buffer = buffers.back().get();
+		owner.buffer->id = nextThreadId++;
+	}
+	return *owner.buffer;
+}
+
+std::string escape(const std::string& text) {
+	std::string escaped;
+	for (char c : text) {
+		if (c == '"' || c == '\\') escaped += '\\';
+		if ((unsigned char)c < 0x20) continue;
+		escaped += c;
+	}
+	return escaped;
+}
+
+}
+
+uint64_t Profiler::Now() {
+#ifdef PROFILER_USE_RDTSC
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void Profiler::Start() {
+	startTime = std::chrono::steady_clock::now();
+	startTicks = Now();
+	{
+		// the events of the last capture are discarded, so are the buffers of finished threads
+		std::lock_guard<std::mutex> lock(registryMutex);
+		buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](const auto& b) { return b->exited; }), buffers.end());
+	}
+	// buffers notice the new capture and drop their old events on the next Record()
+	capture++;
+	capturing = true;
+}
+
+void Profiler::Stop() {
+	capturing = false;
+}
+
+bool Profiler::IsCapturing() {
+	return capturing;
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+	ThreadBuffer& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(buffer.nameMutex);
+	buffer.name = name;
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end, uint32_t depth) {
+	ThreadBuffer& buffer = threadBuffer();
+	uint64_t current = capture.load(std::memory_order_relaxed);
+	if (buffer.capture.load(std::memory_order_relaxed) != current) {
+		buffer.count.store(0, std::memory_order_relaxed);
+		buffer.capture.store(current, std::memory_order_release);
+	}
+
+	size_t index = buffer.count.load(std::memory_order_relaxed);
+	if (index >= MaxEventsPerThread) return;
+	std::unique_ptr<Event[]>& block = buffer.blocks[index / EventsPerBlock];
+	if (!block) block.reset(new Event[EventsPerBlock]);
+	block[index % EventsPerBlock] = Event{name, start, end, depth};
+	buffer.count.store(index + 1, std::memory_order_release);
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) return false;
+
+	// microseconds per tick, with rdtsc measured over the whole capture
+	double scale = 0.001;
+#ifdef PROFILER_USE_RDTSC
+	double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+	uint64_t ticks = Now() - startTicks;
+	scale = ticks ? micros / ticks : 0;
+#endif
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	std::lock_guard<std::mutex> registryLock(registryMutex);
+	for (auto& buffer : buffers) {
+		{
+			std::lock_guard<std::mutex> lock(buffer->nameMutex);
+			if (!buffer->name.empty()) {
+				file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+					<< ",\"args\":{\"name\":\"" << escape(buffer->name) << "\"}}";
+				first = false;
+			}
+		}
+		if (buffer->capture.load(std::memory_order_acquire) != capture) continue;
+
+		// events recorded while writing are left out
+		size_t count = buffer->count.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; i++) {
+			const Event& event = buffer->blocks[i / EventsPerBlock][i % EventsPerBlock];
+			// zones that started before the capture are cut off
+			uint64_t start = std::max(event.start, startTicks);
+			file << (first ? "" : ",\n") << "{\"name\":\"" << escape(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+				<< ",\"ts\":" << (start - startTicks) * scale << ",\"dur\":" << (event.end - start) * scale
+				<< ",\"args\":{\"depth\":" << event.depth << "}}";
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+	return (bool)file;
+}
+
+Profiler::Zone::Zone(const char* name) : name(name), start(0), active(capturing) {
+	if (!active) return;
+	threadBuffer().depth++;
+	start = Now();
+}
+
+Profiler::Zone::~Zone() {
+	if (!active) return;
+	uint64_t end = Now();
+	ThreadBuffer& buffer = threadBuffer();
+	buffer.depth--;
+	Record(name, start, end, buffer.depth);
+}
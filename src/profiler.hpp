@@ -0,0 +1,61 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+#include <string>
+
+// Scoped zone profiler. A zone measures the time from PROFILE_ZONE() to the end of the enclosing
+// scope, zones inside zones show up nested. Every thread records into its own buffer, nothing is
+// recorded unless a capture is running. WriteChromeTrace() exports the capture in the JSON format
+// of chrome://tracing, which Perfetto (ui.perfetto.dev) opens as well.
+//
+// Build with PROFILER_DISABLE to compile all zones out, with PROFILER_USE_RDTSC to read the
+// timestamp counter instead of std::chrono::steady_clock (x86 only, needs an invariant TSC).
+//
+// NOTE: zone names aren't copied, they have to be string literals or live as long as the capture
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+#ifndef PROFILER_DISABLE
+# define PROFILE_ZONE(name) Profiler::Zone PROFILER_CONCAT(profilerZone, __LINE__){name}
+# define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#else
+# define PROFILE_ZONE(name) ((void)0)
+# define PROFILE_FUNCTION() ((void)0)
+#endif
+
+namespace Profiler {
+
+// events per thread and capture, the rest is dropped
+constexpr size_t MaxEventsPerThread = 1 << 20;
+
+// Starts a new capture, events of the last one are discarded
+void Start();
+void Stop();
+bool IsCapturing();
+// Writes all events of the current or last capture, returns false if the file can't be written
+bool WriteChromeTrace(const std::string& path);
+// shows up instead of the thread id in the trace
+void SetThreadName(const std::string& name);
+
+uint64_t Now();
+void Record(const char* name, uint64_t start, uint64_t end, uint32_t depth);
+
+class Zone {
+public:
+	explicit Zone(const char* name);
+	~Zone();
+
+	Zone(const Zone&) = delete;
+	Zone& operator=(const Zone&) = delete;
+
+private:
+	const char* name;
+	uint64_t start;
+	bool active;
+};
+
+}
+
+#endif /* PROFILER_HPP */
@@ -0,0 +1,221 @@
+#include "textureCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+static uint64_t alignSection(uint64_t offset) {
+	return (offset + TextureCache::SectionAlignment - 1) / TextureCache::SectionAlignment * TextureCache::SectionAlignment;
+}
+
+uint64_t TextureCache::Hash(const uint8_t* data, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ data[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+bool TextureCache::GetSource(const std::string& path, Source& source, bool hash) {
+	std::error_code ec;
+	auto mtime = fs::last_write_time(path, ec);
+	if (ec) return false;
+	auto size = fs::file_size(path, ec);
+	if (ec) return false;
+
+	source.mtime = mtime.time_since_epoch().count();
+	source.size = size;
+	source.hash = 0;
+	if (hash) {
+		MappedFile file(path);
+		if (!file.IsOpen()) return false;
+		source.hash = Hash(file.GetData(), file.GetSize());
+	}
+	return true;
+}
+
+bool TextureCache::Save(const std::string& path, const std::vector<cdr::BitmapView>& levels, const Source& source) {
+	if (levels.empty() || levels.size() > MaxMipLevels) return false;
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) return false;
+
+	Header header{};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.format = Format::RGBA8;
+	header.mipCount = levels.size();
+	header.source = source;
+	uint64_t offset = alignSection(sizeof(Header));
+	for (size_t i = 0; i < levels.size(); i++) {
+		MipLevel& level = header.levels[i];
+		level.width = levels[i].GetWidth();
+		level.height = levels[i].GetHeight();
+		// NOTE: rows stay 64 byte aligned in the mapped file too
+		level.pitch = cdr::BaseBitmap::AlignedPitch(level.width);
+		level.offset = offset;
+		offset = alignSection(offset + (uint64_t)level.pitch * level.height * sizeof(uint32_t));
+	}
+
+	uint64_t written = 0;
+	auto write = [&](const void* data, uint64_t size) {
+		out.write(static_cast<const char*>(data), size);
+		written += size;
+	};
+	static const char zeros[SectionAlignment] {};
+	auto padTo = [&](uint64_t offset) {
+		write(zeros, offset - written);
+	};
+
+	write(&header, sizeof(Header));
+	for (size_t i = 0; i < levels.size(); i++) {
+		const MipLevel& level = header.levels[i];
+		padTo(level.offset);
+		for (int y = 0; y < level.height; y++) {
+			write(levels[i].GetData() + (size_t)y * levels[i].GetPitch(), level.width * sizeof(uint32_t));
+			padTo(written + (level.pitch - level.width) * sizeof(uint32_t));
+		}
+	}
+	padTo(offset);
+
+	return (bool)out;
+}
+
+TextureCache::File::File(const std::string& path) {
+	Open(path);
+}
+
+bool TextureCache::File::Open(const std::string& path) {
+	header = nullptr;
+	levels.clear();
+	if (!file.Open(path)) {
+		error = "can't map " + path;
+		return false;
+	}
+
+	const uint8_t* base = file.GetData();
+	const uint64_t size = file.GetSize();
+	const Header* h = reinterpret_cast<const Header*>(base);
+
+	if (size < sizeof(Header) || memcmp(h->magic, Magic, sizeof(Magic)) != 0) {
+		error = path + " is not a texture cache file";
+		return false;
+	}
+	if (h->version != Version) {
+		error = path + " has texture cache version " + std::to_string(h->version) + ", expected " + std::to_string(Version);
+		return false;
+	}
+	if (h->format != Format::RGBA8 || h->mipCount == 0 || h->mipCount > MaxMipLevels) {
+		error = path + " has an unknown format";
+		return false;
+	}
+	for (uint32_t i = 0; i < h->mipCount; i++) {
+		const MipLevel& level = h->levels[i];
+		uint64_t bytes = (uint64_t)level.pitch * level.height * sizeof(uint32_t);
+		if (level.width <= 0 || level.height <= 0 || level.pitch < level.width) {
+			error = path + " has an invalid size";
+			return false;
+		}
+		if (level.offset % SectionAlignment != 0 || level.offset > size || bytes > size - level.offset) {
+			error = path + " is truncated";
+			return false;
+		}
+	}
+
+	header = h;
+	for (uint32_t i = 0; i < h->mipCount; i++) {
+		const MipLevel& level = h->levels[i];
+		levels.emplace_back(reinterpret_cast<const uint32_t*>(base + level.offset), level.width, level.height, level.pitch);
+	}
+	error.clear();
+	return true;
+}
+
+void TextureCache::File::Close() {
+	header = nullptr;
+	levels.clear();
+	file.Close();
+}
+
+cdr::BitmapView TextureCache::File::GetView(int level) const {
+	if (!IsOpen() || level < 0 || level >= (int)levels.size()) return {};
+	if (level == 0) return levels[0].WithMips(levels.data() + 1, levels.size() - 1);
+	return levels[level];
+}
+
+TextureCache::Builder::Builder(const std::string& directory, Validation validation, bool mips) : directory(directory), validation(validation), mips(mips) {
+}
+
+std::string TextureCache::Builder::GetCachePath(const std::string& sourcePath) const {
+	// NOTE: the same image under another path gets its own entry
+	std::error_code ec;
+	std::string absolute = fs::absolute(sourcePath, ec).lexically_normal().string();
+	if (ec) absolute = sourcePath;
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)Hash(reinterpret_cast<const uint8_t*>(absolute.data()), absolute.size()));
+	return (fs::path(directory) / (fs::path(sourcePath).stem().string() + "-" + name + Extension)).string();
+}
+
+bool TextureCache::Builder::isFresh(const File& cached, const Source& source) const {
+	const Source& built = cached.GetSource();
+	if ((cached.GetMipCount() > 1) != mips) return false;
+	if (validation == Validation::Hash) {
+		return built.hash == source.hash && built.size == source.size;
+	}
+	return built.mtime == source.mtime && built.size == source.size;
+}
+
+std::string TextureCache::Builder::Build(const std::string& sourcePath) {
+	File file;
+	return Open(sourcePath, file) ? GetCachePath(sourcePath) : "";
+}
+
+bool TextureCache::Builder::Open(const std::string& sourcePath, File& file) {
+	Source source;
+	if (!GetSource(sourcePath, source, validation == Validation::Hash)) {
+		error = "can't read " + sourcePath;
+		return false;
+	}
+	std::string cachePath = GetCachePath(sourcePath);
+	if (file.Open(cachePath) && isFresh(file, source)) return true;
+	file.Close();
+
+	try {
+		cdr::Bitmap bitmap(sourcePath);
+		builds++;
+		std::vector<cdr::BitmapView> levels;
+		if (mips) bitmap.GenerateMips(MaxMipLevels);
+		cdr::BitmapView view = bitmap;
+		for (int level = 0; level < view.GetMipCount(); level++) levels.push_back(view.GetMip(level));
+		// the hash is stored either way, so the cache works with both validations
+		if (validation != Validation::Hash && !GetSource(sourcePath, source, true)) {
+			error = "can't read " + sourcePath;
+			return false;
+		}
+		std::error_code ec;
+		fs::create_directories(directory, ec);
+		// NOTE: written next to it and renamed, so nobody maps a half written file
+		std::string temporary = cachePath + ".tmp";
+		if (!Save(temporary, levels, source)) {
+			error = "can't write " + temporary;
+			return false;
+		}
+		fs::rename(temporary, cachePath, ec);
+		if (ec) {
+			error = "can't rename " + temporary + ": " + ec.message();
+			return false;
+		}
+	} catch (const std::exception& e) {
+		error = e.what();
+		return false;
+	}
+
+	if (!file.Open(cachePath)) {
+		error = file.GetError();
+		return false;
+	}
+	return true;
+}
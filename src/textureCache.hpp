@@ -0,0 +1,126 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cidr.hpp"
+#include "mappedFile.hpp"
+
+// Raw texture cache files, decoded images that are mapped instead of decoded again
+//
+// Layout (native byte order, every level starts 64 byte aligned):
+//   Header
+//   levels       mipCount images of height rows of pitch pixels, packed RGBA like cdr::Bitmap
+//
+// The pixels are already in the renderer's format, so a cached texture is a view straight into
+// the mapped file. The header remembers the source file to tell when the cached copy is stale.
+namespace TextureCache {
+
+constexpr char Magic[4] { 'B', 'L', 'T', 'X' };
+constexpr uint32_t Version = 1;
+constexpr uint64_t SectionAlignment = 64;
+constexpr int MaxMipLevels = 16;
+constexpr const char* Extension = ".bltx";
+
+enum class Format : uint32_t {
+	// R in the highest byte of an uint32_t, like cdr::Bitmap
+	RGBA8 = 0,
+};
+
+struct MipLevel {
+	int32_t width;
+	int32_t height;
+	int32_t pitch;
+	uint32_t padding{0};
+	uint64_t offset;
+};
+
+// what the cached copy was built from
+struct Source {
+	int64_t mtime{0};
+	uint64_t size{0};
+	// FNV-1a of the whole file
+	uint64_t hash{0};
+};
+
+struct Header {
+	char magic[4];
+	uint32_t version;
+	Format format;
+	uint32_t mipCount;
+	Source source;
+	MipLevel levels[MaxMipLevels];
+};
+
+enum class Validation {
+	// the source's modification time and size, cheap
+	Mtime,
+	// the content of the source, reads all of it
+	Hash,
+};
+
+// Writes the levels, the first one is the full size texture
+bool Save(const std::string& path, const std::vector<cdr::BitmapView>& levels, const Source& source);
+// mtime and size, the hash only if hash is set. False if the file doesn't exist
+bool GetSource(const std::string& path, Source& source, bool hash);
+uint64_t Hash(const uint8_t* data, size_t size);
+
+// A cached texture mapped into memory
+class File {
+public:
+	File() = default;
+	File(const std::string& path);
+
+	bool Open(const std::string& path);
+	void Close();
+
+	inline bool IsOpen() const { return header != nullptr; }
+	inline const std::string& GetError() const { return error; }
+
+	inline int GetWidth() const { return header->levels[0].width; }
+	inline int GetHeight() const { return header->levels[0].height; }
+	inline int GetMipCount() const { return header->mipCount; }
+	inline const Source& GetSource() const { return header->source; }
+	// read only view into the mapped file, valid as long as the file is open.
+	// The view of level 0 comes with the other levels as its mips. The view is empty if the
+	// file isn't open or there's no such level.
+	cdr::BitmapView GetView(int level = 0) const;
+
+private:
+	MappedFile file;
+	const Header* header{nullptr};
+	std::vector<cdr::BitmapView> levels;
+	std::string error;
+};
+
+// Converts source images into cache files in a directory once, and again when they change
+class Builder {
+public:
+	// with mips the cache files store the mip chain too
+	explicit Builder(const std::string& directory, Validation validation = Validation::Mtime, bool mips = false);
+
+	// The cache file for the source image, built if it's missing or stale. Empty on failure
+	std::string Build(const std::string& sourcePath);
+	// Builds if needed and maps the cache file
+	bool Open(const std::string& sourcePath, File& file);
+
+	// where the cached copy of the source goes, whether it exists or not
+	std::string GetCachePath(const std::string& sourcePath) const;
+	inline const std::string& GetError() const { return error; }
+	// sources that had to be decoded
+	inline int GetBuildCount() const { return builds; }
+
+private:
+	std::string directory;
+	Validation validation;
+	bool mips;
+	std::string error;
+	int builds{0};
+
+	bool isFresh(const File& cached, const Source& source) const;
+};
+
+}
+
+#endif /* TEXTURE_CACHE_HPP */
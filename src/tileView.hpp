@@ -0,0 +1,36 @@
+#ifndef TILEVIEW_HPP
+#define TILEVIEW_HPP
+
+#include <string>
+#include <vector>
+
+// Non owning, [y][x] indexed view over a tile grid. The rows don't have to be
+// contiguous, so it works over Generation::map as well as over a mapped level.
+class TileView {
+public:
+	TileView() = default;
+	TileView(const std::vector<std::string>& map) : width(map.empty() ? 0 : map[0].size()), height(map.size()) {
+		rows.reserve(height);
+		for (const auto& row : map) {
+			rows.push_back(row.data());
+		}
+	}
+	TileView(const char* data, int width, int height, int pitch) : width(width), height(height) {
+		rows.reserve(height);
+		for (int y = 0; y < height; y++) {
+			rows.push_back(data + y * pitch);
+		}
+	}
+
+	inline const char* operator[](int y) const { return rows[y]; }
+	inline char At(int x, int y) const { return rows[y][x]; }
+	inline int GetWidth() const { return width; }
+	inline int GetHeight() const { return height; }
+
+private:
+	std::vector<const char*> rows;
+	int width{0};
+	int height{0};
+};
+
+#endif /* TILEVIEW_HPP */
@@ -0,0 +1,195 @@
+#include "world.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+World::World(uint32_t seed, int cacheCapacity, int roomsPerChunk, int minRoomSize, int maxRoomSize)
+	: seed(seed), cacheCapacity(std::max(cacheCapacity, 1)), roomsPerChunk(roomsPerChunk),
+	minRoomSize(minRoomSize), maxRoomSize(maxRoomSize) {
+	lookup.reserve(this->cacheCapacity);
+}
+
+void World::Update(int cameraX, int cameraY, int radius, int evictRadius) {
+	int centerX = ToChunk(cameraX);
+	int centerY = ToChunk(cameraY);
+
+	for (auto it = chunks.begin(); it != chunks.end();) {
+		if (std::abs(it->chunkX - centerX) > evictRadius || std::abs(it->chunkY - centerY) > evictRadius) {
+			lookup.erase(key(it->chunkX, it->chunkY));
+			it = chunks.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	for (int cy = centerY - radius; cy <= centerY + radius; cy++) {
+		for (int cx = centerX - radius; cx <= centerX + radius; cx++) {
+			GetChunk(cx, cy);
+		}
+	}
+}
+
+const World::Chunk& World::GetChunk(int chunkX, int chunkY) {
+	if (auto it = lookup.find(key(chunkX, chunkY)); it != lookup.end()) {
+		chunks.splice(chunks.begin(), chunks, it->second);
+		return chunks.front();
+	}
+
+	if ((int)chunks.size() >= cacheCapacity) {
+		evictLeastRecentlyUsed();
+	}
+
+	chunks.emplace_front();
+	Chunk& chunk = chunks.front();
+	chunk.chunkX = chunkX;
+	chunk.chunkY = chunkY;
+	generate(chunk);
+	lookup[key(chunkX, chunkY)] = chunks.begin();
+	return chunk;
+}
+
+char World::GetTile(int x, int y) {
+	const Chunk& chunk = GetChunk(ToChunk(x), ToChunk(y));
+	return chunk.tiles.At(ToLocal(x), ToLocal(y));
+}
+
+const World::Chunk* World::FindChunk(int chunkX, int chunkY) const {
+	auto it = lookup.find(key(chunkX, chunkY));
+	return it != lookup.end() ? &*it->second : nullptr;
+}
+
+void World::GetResidentBounds(int& x, int& y, int& width, int& height) const {
+	if (chunks.empty()) {
+		x = y = width = height = 0;
+		return;
+	}
+
+	int minX = chunks.front().chunkX, maxX = minX;
+	int minY = chunks.front().chunkY, maxY = minY;
+	for (const auto& chunk : chunks) {
+		minX = std::min(minX, chunk.chunkX);
+		maxX = std::max(maxX, chunk.chunkX);
+		minY = std::min(minY, chunk.chunkY);
+		maxY = std::max(maxY, chunk.chunkY);
+	}
+
+	x = minX * ChunkSize;
+	y = minY * ChunkSize;
+	width = (maxX - minX + 1) * ChunkSize;
+	height = (maxY - minY + 1) * ChunkSize;
+}
+
+void World::CopyRegion(int x, int y, int width, int height, std::vector<std::string>& out) const {
+	out.resize(height);
+	for (int j = 0; j < height; j++) {
+		std::string& row = out[j];
+		row.assign(width, Generation::Tile_Empty);
+
+		int tileY = y + j;
+		int localY = ToLocal(tileY);
+		// copy whole chunk wide spans of the row at once
+		for (int i = 0; i < width;) {
+			int tileX = x + i;
+			int span = std::min(ChunkSize - ToLocal(tileX), width - i);
+			if (const Chunk* chunk = FindChunk(ToChunk(tileX), ToChunk(tileY))) {
+				chunk->tiles.DecompressRow(localY, ToLocal(tileX), span, &row[i]);
+			}
+			i += span;
+		}
+	}
+}
+
+uint32_t World::hash(int a, int b, int c) const {
+	uint32_t h = seed * 0x9E3779B1u;
+	for (uint32_t v : { (uint32_t)a, (uint32_t)b, (uint32_t)c }) {
+		h ^= v + 0x9E3779B9u + (h << 6) + (h >> 2);
+	}
+	// murmur3 finalizer
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	return h;
+}
+
+void World::generate(Chunk& chunk) {
+	// NOTE: seeding the generator from the chunk is what makes chunks reproducible
+	Generation gen(ChunkSize, ChunkSize, 4, 4, 4, 4);
+	gen.rng.seed(hash(chunk.chunkX, chunk.chunkY, 2));
+	gen.Start(roomsPerChunk, minRoomSize, maxRoomSize, minRoomSize, maxRoomSize);
+	std::vector<std::string>& map = gen.map;
+
+	// there's only one player in the world, not one per chunk
+	for (auto& row : map) {
+		std::replace(row.begin(), row.end(), (char)Generation::Tile_Player, (char)Generation::Tile_Floor);
+	}
+
+	// every seam gets a gate position that both chunks sharing it agree on,
+	// so the corridors carved from either side meet at the seam
+	const int margin = 8;
+	auto gate = [&](int seamX, int seamY, int orientation) {
+		return margin + (int)(hash(seamX, seamY, orientation) % (ChunkSize - 2 * margin));
+	};
+	carveSeam(map, gate(chunk.chunkX, chunk.chunkY,     0), 0); // top
+	carveSeam(map, gate(chunk.chunkX, chunk.chunkY + 1, 0), 1); // bottom
+	carveSeam(map, gate(chunk.chunkX + 1, chunk.chunkY, 1), 2); // right
+	carveSeam(map, gate(chunk.chunkX, chunk.chunkY,     1), 3); // left
+
+	// mostly empty space and walls, so most rows end up run length encoded
+	chunk.tiles.Compress(TileView(map));
+}
+
+// Carves a corridor from the gate on the given side (0 top, 1 bottom, 2 right, 3 left)
+// towards the chunk centre until it runs into the floor of a room. If there is no room
+// in the way the corridor turns at the centre line, so all gates still meet in the middle.
+void World::carveSeam(std::vector<std::string>& map, int gate, int side) {
+	const int center = ChunkSize / 2;
+
+	auto isRoom = [&](int x, int y) {
+		char tile = map[y][x];
+		return tile != Generation::Tile_Empty && tile != Generation::Tile_Wall;
+	};
+	auto carve = [&](int x, int y, int sideX, int sideY) {
+		map[y][x] = Generation::Tile_Floor;
+		for (int s : { -1, 1 }) {
+			int nx = x + sideX * s;
+			int ny = y + sideY * s;
+			if (nx < 0 || ny < 0 || nx >= ChunkSize || ny >= ChunkSize) continue;
+			if (map[ny][nx] == Generation::Tile_Empty) {
+				map[ny][nx] = Generation::Tile_Wall;
+			}
+		}
+	};
+
+	bool vertical = side < 2;
+	int x = vertical ? gate : (side == 2 ? ChunkSize - 1 : 0);
+	int y = vertical ? (side == 1 ? ChunkSize - 1 : 0) : gate;
+	int stepX = vertical ? 0 : (side == 2 ? -1 : 1);
+	int stepY = vertical ? (side == 1 ? -1 : 1) : 0;
+
+	// straight in from the edge
+	while ((vertical ? y : x) != center) {
+		if (isRoom(x, y)) return;
+		carve(x, y, stepY != 0, stepX != 0);
+		x += stepX;
+		y += stepY;
+	}
+
+	// along the centre line to the middle of the chunk
+	stepX = vertical ? (gate < center ? 1 : -1) : 0;
+	stepY = vertical ? 0 : (gate < center ? 1 : -1);
+	while (true) {
+		if (isRoom(x, y)) return;
+		carve(x, y, stepY != 0, stepX != 0);
+		if (x == center && y == center) return;
+		x += stepX;
+		y += stepY;
+	}
+}
+
+void World::evictLeastRecentlyUsed() {
+	const Chunk& last = chunks.back();
+	lookup.erase(key(last.chunkX, last.chunkY));
+	chunks.pop_back();
+}
@@ -0,0 +1,74 @@
+#ifndef WORLD_HPP
+#define WORLD_HPP
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "compressedMap.hpp"
+#include "generation.hpp"
+
+// An endless dungeon made out of fixed size chunks. Every chunk is generated
+// on demand from (seed, chunkX, chunkY), so an evicted chunk comes back
+// exactly the same when the camera returns to it.
+class World {
+public:
+	static constexpr int ChunkSize = 64;
+
+	struct Chunk {
+		int chunkX{0};
+		int chunkY{0};
+		// ChunkSize x ChunkSize tiles, compressed so a lot more chunks fit in the cache
+		CompressedMap tiles;
+	};
+
+	World(uint32_t seed, int cacheCapacity = 64, int roomsPerChunk = 8, int minRoomSize = 6, int maxRoomSize = 8);
+
+	// Loads every chunk within `radius` chunks of the camera (in tiles) and
+	// evicts the ones that are further away than `evictRadius` chunks
+	void Update(int cameraX, int cameraY, int radius = 1, int evictRadius = 2);
+
+	// Generates the chunk if it isn't resident yet
+	const Chunk& GetChunk(int chunkX, int chunkY);
+	char GetTile(int x, int y);
+	// Never generates, returns nullptr if the chunk isn't resident
+	const Chunk* FindChunk(int chunkX, int chunkY) const;
+
+	// Bounding box of the resident chunks in tile coordinates
+	void GetResidentBounds(int& x, int& y, int& width, int& height) const;
+	// Copies a tile region out of the resident chunks into a Generation::map
+	// like grid, tiles of chunks that aren't resident are Tile_Empty
+	void CopyRegion(int x, int y, int width, int height, std::vector<std::string>& out) const;
+
+	inline uint32_t GetSeed() const { return seed; }
+	inline int GetResidentCount() const { return chunks.size(); }
+
+	static inline int ToChunk(int tile) {
+		return (tile >= 0 ? tile : tile - ChunkSize + 1) / ChunkSize;
+	}
+	static inline int ToLocal(int tile) {
+		return tile - ToChunk(tile) * ChunkSize;
+	}
+
+private:
+	uint32_t seed;
+	int cacheCapacity;
+	int roomsPerChunk;
+	int minRoomSize;
+	int maxRoomSize;
+
+	// most recently used chunk is at the front
+	std::list<Chunk> chunks;
+	std::unordered_map<uint64_t, std::list<Chunk>::iterator> lookup;
+
+	static inline uint64_t key(int chunkX, int chunkY) {
+		return (uint64_t)(uint32_t)chunkX << 32 | (uint32_t)chunkY;
+	}
+	uint32_t hash(int a, int b, int c) const;
+	void generate(Chunk& chunk);
+	void carveSeam(std::vector<std::string>& map, int gate, int side);
+	void evictLeastRecentlyUsed();
+};
+
+#endif /* WORLD_HPP */